@@ -4,28 +4,181 @@
 #include <set>
 #include <map>
 #include <vector>
+#include <list>
 #include <queue>
 #include <algorithm>
+#include <numeric>
 #include <cstdlib>
-#include <ctime>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
 #include <unordered_set>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <random>
+#include <cctype>
+#include <iomanip>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 using namespace std;
 
-// Global variables
-unordered_set<string> existingIds;
 class Book;
+class Booking;
 class User;
 class Student;
 class Faculty;
 class Librarian;
 class Library;
+struct ReportOptions;
+
+// Enum for the kinds of generated IDs
+enum class IdKind
+{
+    BOOK,
+    STUDENT,
+    FACULTY,
+    LIBRARIAN,
+    BOOKING
+};
+
+// Calendar date held as a day number (days since 01-01-1970). Dates are parsed once from
+// ddmmyyyy text, differences are a subtraction, and the civil date is only rebuilt for
+// display and CSV output. A default-constructed Date is the "N/A" placeholder.
+class Date
+{
+    static const int32_t unset = INT32_MIN;
+    int32_t dayNumber = unset;
+
+public:
+    Date() {}
+    explicit Date(int32_t dayNumber) : dayNumber(dayNumber) {}
+
+    // Day number of a proleptic Gregorian date
+    static Date fromCivil(int year, int month, int day)
+    {
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        int yearOfEra = year - era * 400;
+        int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return Date(era * 146097 + dayOfEra - 719468);
+    }
+
+    void toCivil(int &year, int &month, int &day) const
+    {
+        int z = dayNumber + 719468;
+        int era = (z >= 0 ? z : z - 146096) / 146097;
+        int dayOfEra = z - era * 146097;
+        int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        int monthIndex = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        year = yearOfEra + era * 400 + (month <= 2);
+    }
+
+    // Parses ddmmyyyy (or "N/A" for no date); returns false for anything else
+    static bool parse(string_view text, Date &date)
+    {
+        if (text == "N/A")
+        {
+            date = Date();
+            return true;
+        }
+        if (text.size() != 8)
+            return false;
+        int digits[8];
+        for (int i = 0; i < 8; i++)
+        {
+            if (text[i] < '0' || text[i] > '9')
+                return false;
+            digits[i] = text[i] - '0';
+        }
+        int day = digits[0] * 10 + digits[1];
+        int month = digits[2] * 10 + digits[3];
+        int year = digits[4] * 1000 + digits[5] * 100 + digits[6] * 10 + digits[7];
+        if (month < 1 || month > 12 || day < 1)
+            return false;
+
+        // Reject days past the end of the month by converting back
+        Date parsed = fromCivil(year, month, day);
+        int y, m, d;
+        parsed.toCivil(y, m, d);
+        if (d != day)
+            return false;
+        date = parsed;
+        return true;
+    }
+
+    // Appends ddmmyyyy, or "N/A" for no date
+    void appendTo(string &out) const
+    {
+        if (!isSet())
+        {
+            out += "N/A";
+            return;
+        }
+        int year, month, day;
+        toCivil(year, month, day);
+        char text[8] = {char('0' + day / 10), char('0' + day % 10), char('0' + month / 10), char('0' + month % 10),
+                        char('0' + year / 1000 % 10), char('0' + year / 100 % 10), char('0' + year / 10 % 10),
+                        char('0' + year % 10)};
+        out.append(text, 8);
+    }
+
+    string toString() const
+    {
+        string text;
+        appendTo(text);
+        return text;
+    }
+
+    bool isSet() const { return dayNumber != unset; }
+    int32_t days() const { return dayNumber; }
+
+    int operator-(Date other) const { return dayNumber - other.dayNumber; }
+    Date operator+(int offset) const { return Date(dayNumber + offset); }
+    bool operator==(Date other) const { return dayNumber == other.dayNumber; }
+    bool operator!=(Date other) const { return dayNumber != other.dayNumber; }
+    bool operator<(Date other) const { return dayNumber < other.dayNumber; }
+};
+
+ostream &operator<<(ostream &out, Date date)
+{
+    return out << date.toString();
+}
 
 // Function prototypes
-string generateUniqueId();
-tm parseDate(const string &date);
-int daysBetweenDates(const string &date1, const string &date2);
-int calculateFine(const string &borrowDate, const string &returnDate);
+string generateUniqueId(IdKind kind);
+int daysBetweenDates(Date date1, Date date2);
+int calculateFine(Date borrowDate, Date returnDate);
+string bookRow(const Book *book);
+string userRow(const User *user, const string &userType);
+string bookingRow(const Booking *booking);
+void indexDueDate(const Booking *booking);
+void unindexDueDate(const Booking *booking);
+void recordHistory(Booking *booking);
+void retractHistory(const Booking *booking);
+void endSessions(const User *user);
+void commitJournal();
+void compactJournal();
 
 // Enum for booking type
 enum class BookingType
@@ -38,10 +191,104 @@ enum class BookingType
 enum class BookStatus
 {
     AVAILABLE,
-    BORROWED
+    BORROWED,
+    DELETED // Tombstone of a deleted book, kept while bookings refer to it
 };
 
+// Status as written in library_data.csv
+const char *bookStatusName(BookStatus status)
+{
+    switch (status)
+    {
+    case BookStatus::AVAILABLE:
+        return "Available";
+    case BookStatus::BORROWED:
+        return "Borrowed";
+    case BookStatus::DELETED:
+        return "Deleted";
+    }
+    return "";
+}
+
 // Class declarations
+
+// FIFO of the users waiting for a book. Push, pop-front and cancel-by-user are O(1);
+// each user holds at most one place in a queue.
+class ReservationQueue
+{
+    list<string> order;
+    unordered_map<string, list<string>::iterator> entryOf;
+
+public:
+    ReservationQueue() {}
+    ReservationQueue(const ReservationQueue &other) { *this = other; }
+
+    ReservationQueue &operator=(const ReservationQueue &other)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (const string &userId : other.order)
+                push(userId);
+        }
+        return *this;
+    }
+
+    // Returns false if the user is already queued
+    bool push(const string &userId)
+    {
+        if (entryOf.count(userId))
+            return false;
+        order.push_back(userId);
+        entryOf.emplace(userId, prev(order.end()));
+        return true;
+    }
+
+    const string &front() const { return order.front(); }
+
+    void pop()
+    {
+        entryOf.erase(order.front());
+        order.pop_front();
+    }
+
+    // Returns false if the user is not queued
+    bool erase(const string &userId)
+    {
+        auto it = entryOf.find(userId);
+        if (it == entryOf.end())
+            return false;
+        order.erase(it->second);
+        entryOf.erase(it);
+        return true;
+    }
+
+    bool contains(const string &userId) const { return entryOf.count(userId) > 0; }
+
+    // 1-based place in line, or 0 if the user is not queued; walks only the users ahead
+    size_t position(const string &userId) const
+    {
+        auto it = entryOf.find(userId);
+        if (it == entryOf.end())
+            return 0;
+        size_t place = 1;
+        for (auto entry = order.begin(); entry != it->second; ++entry)
+            place++;
+        return place;
+    }
+
+    void clear()
+    {
+        order.clear();
+        entryOf.clear();
+    }
+
+    size_t size() const { return order.size(); }
+    bool empty() const { return order.empty(); }
+    list<string>::const_iterator begin() const { return order.begin(); }
+    list<string>::const_iterator end() const { return order.end(); }
+};
+
 class Book
 {
 public:
@@ -52,69 +299,236 @@ public:
     string ISBN;
     int year;
     BookStatus status;
-    vector<string> reservationQueue;
+    ReservationQueue reservationQueue;
 
     Book() {}
     Book(string bookId, string title, string author, string publisher, string ISBN, int year);
 };
 
-class Booking : public Book
+// One borrow or reservation. The book's details are read through `book`, which stays
+// valid after the book is deleted (it is then a tombstone in library.deletedBooks).
+class Booking
 {
 public:
     string bookingId;
-    string bookingDate;
-    string borrowDate;
-    string returnDate;
+    Book *book;
+    User *user;
+    Date bookingDate;
+    Date borrowDate;
+    Date returnDate;
     int fine;
     BookingType type;
-    string bookId;
+    uint32_t historyRow = UINT32_MAX; // Row in the history store while the booking is a loan in `history`
 
-    Booking() {}
-    Booking(string bookingId, string bookingDate, string borrowDate, string returnDate, int fine, BookingType type,
-            string bookId, string title, string author, string publisher, string ISBN, int year);
+    Booking(string bookingId, Book *book, User *user, Date bookingDate, Date borrowDate, Date returnDate, int fine,
+            BookingType type);
 };
 
 class Account
 {
+    // Borrow dates of the direct borrows in `current`; never more than the role's borrowing limit
+    multiset<Date> borrowDates;
+    long long borrowDaySum = 0;
+
+    // Bookings in `current` by book ID, one table per BookingType
+    unordered_multimap<string, Booking *> byBook[2];
+
+    // Bumped by every change to `current`; cached eligibility is only valid at one revision
+    size_t changes = 0;
+
+    void index(Booking *booking)
+    {
+        byBook[static_cast<int>(booking->type)].emplace(booking->book->bookId, booking);
+    }
+
+    void unindex(const Booking *booking)
+    {
+        auto &table = byBook[static_cast<int>(booking->type)];
+        auto range = table.equal_range(booking->book->bookId);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == booking)
+            {
+                table.erase(it);
+                return;
+            }
+        }
+    }
+
+    void trackBorrow(const Booking *booking)
+    {
+        if (booking->type == BookingType::DIRECT_BORROW && booking->borrowDate.isSet())
+        {
+            borrowDates.insert(booking->borrowDate);
+            borrowDaySum += booking->borrowDate.days();
+            indexDueDate(booking);
+        }
+    }
+
+    void untrackBorrow(const Booking *booking)
+    {
+        if (booking->type != BookingType::DIRECT_BORROW)
+            return;
+        auto it = borrowDates.find(booking->borrowDate);
+        if (it != borrowDates.end())
+        {
+            borrowDaySum -= it->days();
+            borrowDates.erase(it);
+            unindexDueDate(booking);
+        }
+    }
+
 public:
     map<string, Booking *> current;
     map<string, Booking *> history;
+
+    // All changes to `current` go through these so the borrow aggregates stay in step
+    void addCurrent(Booking *booking)
+    {
+        Booking *&slot = current[booking->bookingId];
+        if (slot)
+        {
+            untrackBorrow(slot);
+            unindex(slot);
+        }
+        changes++;
+        slot = booking;
+        trackBorrow(booking);
+        index(booking);
+    }
+
+    Booking *removeCurrent(const string &bookingId)
+    {
+        auto it = current.find(bookingId);
+        if (it == current.end())
+            return nullptr;
+        Booking *booking = it->second;
+        untrackBorrow(booking);
+        unindex(booking);
+        current.erase(it);
+        changes++;
+        return booking;
+    }
+
+    void moveToHistory(map<string, Booking *>::iterator it)
+    {
+        Booking *booking = it->second;
+        untrackBorrow(booking);
+        unindex(booking);
+        current.erase(it);
+        changes++;
+        addHistory(booking);
+    }
+
+    // All additions to `history` go through this so the history store stays in step.
+    // Returns the booking with the same ID that this one replaces, if any.
+    Booking *addHistory(Booking *booking)
+    {
+        Booking *&slot = history[booking->bookingId];
+        Booking *replaced = slot;
+        if (replaced)
+            retractHistory(replaced);
+        slot = booking;
+        recordHistory(booking);
+        return replaced;
+    }
+
+    void convertReservation(Booking *booking, Date date)
+    {
+        unindex(booking);
+        booking->type = BookingType::DIRECT_BORROW;
+        booking->borrowDate = date;
+        booking->returnDate = Date();
+        booking->fine = 0;
+        trackBorrow(booking);
+        index(booking);
+        changes++;
+    }
+
+    // Current booking of `type` for a book, or nullptr
+    Booking *findCurrent(const string &bookId, BookingType type) const
+    {
+        const auto &table = byBook[static_cast<int>(type)];
+        auto it = table.find(bookId);
+        return it == table.end() ? nullptr : it->second;
+    }
+
+    int activeBorrows() const { return static_cast<int>(borrowDates.size()); }
+
+    size_t revision() const { return changes; }
+
+    Date earliestBorrow() const { return borrowDates.empty() ? Date() : *borrowDates.begin(); }
+
+    // Fine accrued by the direct borrows if they were all returned on `date`
+    int fineOn(Date date) const
+    {
+        if (borrowDates.empty() || calculateFine(*borrowDates.begin(), date) == 0)
+            return 0; // Nothing is overdue
+        if (calculateFine(*borrowDates.rbegin(), date) > 0)
+        {
+            // Everything is overdue: sum of (date - borrowDate - 15) * 10
+            long long overdueDays = static_cast<long long>(borrowDates.size()) * (date.days() - 15) - borrowDaySum;
+            return static_cast<int>(overdueDays * 10);
+        }
+        int total = 0;
+        for (Date borrowDate : borrowDates)
+            total += calculateFine(borrowDate, date);
+        return total;
+    }
 };
 
 class User
 {
 protected:
-    string password; // Password is protected
+    string credential; // The salted password hash, or a legacy plaintext password
+
+    // Last mayBorrow() answer: whether the user could borrow on `eligibleOn`, while the
+    // account is still at `eligibleRevision`
+    Date eligibleOn;
+    size_t eligibleRevision = 0;
+    bool eligible = false;
+
 public:
     string UniqueId;
     string name;
     Account account;
 
     User() {}
-    User(string name, string ID, string password);
+    User(string name, string ID, string credential);
 
-    // Public method to get the password
-    string getPassword() const
+    // The stored credential, as written to library_data.csv
+    const string &getCredential() const
     {
-        return password;
+        return credential;
     }
 
-    // Public method to set the password
-    void setPassword(const string &newPassword)
+    void setCredential(const string &newCredential)
     {
-        password = newPassword;
+        credential = newCredential;
     }
 
-    virtual void borrowBook(string date) = 0;
-    virtual void returnBook(string date) = 0;
-    virtual void current_booking(string date) = 0;
+    virtual void borrowBook(Date date);
+    virtual void returnBook(Date date);
+    virtual void current_booking(Date date, const ReportOptions &options) = 0;
     virtual void login() = 0;
 
+    // Borrowing rules of the role: why the user may not borrow on `date` (empty if they
+    // may), and whether late returns are fined
+    virtual string ineligibilityReason(Date date) = 0;
+    virtual bool paysFines() const { return false; }
+    // Days a direct borrow may be kept before it is overdue
+    virtual int loanDays() const { return 0; }
+    bool isEligibleToBorrow(Date date);
+    bool mayBorrow(Date date);
+    bool eligibilityCached(Date date) const;
+    void takeReservation(Booking *reservation, Date date);
+
     void cancelReservation(const string &bookId);
-    void showHistory();
-    bool authenticate(string pass);
+    void showHistory(const ReportOptions &options);
+    bool authenticate(const string &password) const;
 
-    void list_books();
+    void list_books(const ReportOptions &options);
+    void searchBooks();
 };
 
 class Student : public User
@@ -122,24 +536,27 @@ class Student : public User
 public:
     Student(string name, string ID, string password);
 
-    void borrowBook(string date) override;
-    void returnBook(string date) override;
-    void current_booking(string date) override;
+    void current_booking(Date date, const ReportOptions &options) override;
     void login() override;
+    string ineligibilityReason(Date date) override;
+    bool paysFines() const override { return true; }
+    int loanDays() const override { return 15; }
 
-    int tell_fine(string returnDate);
-    bool isEligibleToBorrow(string date);
+    int tell_fine(Date returnDate);
 };
 
 class Faculty : public User
 {
 public:
+    static const int blockDays = 90; // A borrow older than this blocks new ones
+
     Faculty(string name, string ID, string password);
 
-    void borrowBook(string date) override;
-    void returnBook(string date) override;
-    void current_booking(string date) override;
-    bool isEligibleToBorrow(string date);
+    void current_booking(Date date, const ReportOptions &options) override;
+    string ineligibilityReason(Date date) override;
+    // Faculty have no due date and pay no fines; a borrow only counts as overdue once it
+    // blocks further borrowing
+    int loanDays() const override { return blockDays; }
     void login() override;
 };
 
@@ -148,1511 +565,6148 @@ class Librarian : public User
 public:
     Librarian(string name, string ID, string password);
 
-    void borrowBook(string date) override {}
-    void returnBook(string date) override {}
-    void current_booking(string date) override {}
+    void borrowBook(Date) override {}
+    void returnBook(Date) override {}
+    void current_booking(Date, const ReportOptions &) override {}
+    string ineligibilityReason(Date) override { return "Librarians cannot borrow books."; }
     void addNewUser();
     void addNewBook();
-    void listUsers();
+    void listUsers(const ReportOptions &options);
     void deleteUser();
     void deleteBook();
     void login() override;
 };
 
-class Library
+// Direct borrows of every account ordered by due date: the borrow date plus the borrower's
+// loan period. The bookings overdue on a date are a prefix of the index, so finding them
+// costs O(log n + overdue) however many books are out.
+class DueDateIndex
 {
-public:
-    map<string, Book *> books;
-    map<string, Student *> students;
-    map<string, Faculty *> faculties;
-    map<string, Librarian *> librarians;
-    map<string, string> userTypes; // Map to store user types (student, faculty, librarian)
+    set<pair<Date, const Booking *>> entries;
+    mutable mutex lock; // Server sessions borrow and return in parallel
 
-    Library()
+public:
+    void add(Date due, const Booking *booking)
     {
-        this->books = map<string, Book *>();
-        this->students = map<string, Student *>();
-        this->faculties = map<string, Faculty *>();
-        this->librarians = map<string, Librarian *>();
-        this->userTypes = map<string, string>();
+        lock_guard<mutex> guard(lock);
+        entries.emplace(due, booking);
     }
-};
-
-// Global library instance
-Library library;
-
-// Function definitions
-string generateUniqueId()
-{
-    const string charset = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    const int idLength = 10;
-    string id;
-    srand(time(0));
-
-    do
-    {
-        id.clear();
-        for (int i = 0; i < idLength; ++i)
-        {
-            id += charset[rand() % charset.length()];
-        }
-    } while (existingIds.count(id));
-
-    existingIds.insert(id);
-    return id;
-}
-
-tm parseDate(const string &date)
-{
-    tm t = {};
 
-    if (date.length() != 8)
+    void remove(Date due, const Booking *booking)
     {
-        cerr << "Invalid date format. Use ddmmyyyy." << endl;
-        exit(1);
+        lock_guard<mutex> guard(lock);
+        entries.erase({due, booking});
     }
 
-    int day = stoi(date.substr(0, 2));
-    int month = stoi(date.substr(2, 2));
-    int year = stoi(date.substr(4, 4));
-
-    t.tm_mday = day;
-    t.tm_mon = month - 1;
-    t.tm_year = year - 1900;
-
-    return t;
-}
-
-int daysBetweenDates(const string &date1, const string &date2)
-{
-    tm t1 = parseDate(date1);
-    tm t2 = parseDate(date2);
-
-    time_t time1 = mktime(&t1);
-    time_t time2 = mktime(&t2);
-
-    if (time1 == -1 || time2 == -1)
+    // Bookings due before `date`, earliest first
+    vector<const Booking *> overdue(Date date) const
     {
-        cerr << "Error parsing dates." << endl;
-        return -1;
+        lock_guard<mutex> guard(lock);
+        vector<const Booking *> bookings;
+        for (auto it = entries.begin(); it != entries.end() && it->first < date; ++it)
+            bookings.push_back(it->second);
+        return bookings;
     }
 
-    double difference = difftime(time2, time1) / (60 * 60 * 24);
-    return abs(static_cast<int>(difference));
-}
-
-int calculateFine(const string &borrowDate, const string &returnDate)
-{
-    int days = daysBetweenDates(borrowDate, returnDate);
-    int fine = 0;
-
-    if (days > 15)
+    size_t size() const
     {
-        fine = (days - 15) * 10; // Fine of 10 rupees per day for each day beyond 15
+        lock_guard<mutex> guard(lock);
+        return entries.size();
     }
+};
 
-    return fine;
-}
+// Global due date index; Account keeps it in step with the direct borrows in `current`
+DueDateIndex dueDates;
 
-// Book class functions
-Book::Book(string bookId, string title, string author, string publisher, string ISBN, int year)
+Date dueDate(const Booking *booking)
 {
-    this->bookId = bookId;
-    this->title = title;
-    this->author = author;
-    this->publisher = publisher;
-    this->ISBN = ISBN;
-    this->year = year;
-    this->status = BookStatus::AVAILABLE;
-    this->reservationQueue = vector<string>();
+    return booking->borrowDate + booking->user->loanDays();
 }
 
-// Booking class functions
-Booking::Booking(string bookingId, string bookingDate, string borrowDate, string returnDate, int fine, BookingType type,
-                 string bookId, string title, string author, string publisher, string ISBN, int year)
+void indexDueDate(const Booking *booking)
 {
-    this->bookId = bookId;
-    this->title = title;
-    this->author = author;
-    this->publisher = publisher;
-    this->ISBN = ISBN;
-    this->year = year;
-    this->bookingId = bookingId;
-    this->bookingDate = bookingDate;
-    this->borrowDate = borrowDate;
-    this->returnDate = returnDate;
-    this->fine = fine;
-    this->type = type;
+    dueDates.add(dueDate(booking), booking);
 }
 
-// User class functions
-User::User(string name, string ID, string password)
+void unindexDueDate(const Booking *booking)
 {
-    this->name = name;
-    this->UniqueId = ID;
-    this->password = password;
-    this->account = Account();
+    dueDates.remove(dueDate(booking), booking);
 }
 
-void User::cancelReservation(const string &bookId)
+// Catalog books by ID in an open-addressing hash table with linear probing. A slot holds
+// the ID's hash next to the Book pointer, so a lookup usually reads one slot and compares
+// IDs only when the hashes match. The books themselves live in bookPool, whose slabs keep
+// them contiguous and never move them. Iteration order is unspecified; sorted() gives the
+// ID order that listings and the CSV use.
+class BookCatalog
 {
-    if (library.books.count(bookId))
+    struct Slot
     {
-        Book *book = library.books[bookId];
-        auto it = find(book->reservationQueue.begin(), book->reservationQueue.end(), this->UniqueId);
-        if (it != book->reservationQueue.end())
-        {
-            book->reservationQueue.erase(it);
-            cout << "Reservation cancelled successfully for book ID: " << bookId << endl;
+        size_t hash;
+        Book *book; // nullptr when the slot is empty
+    };
 
-            for (auto &bookingPair : account.current)
-            {
-                if (bookingPair.second->ISBN == bookId && bookingPair.second->type == BookingType::RESERVED)
-                {
-                    account.current.erase(bookingPair.first);
-                    break;
-                }
-            }
-        }
-        else
-        {
-            cout << "No reservation found for book ID: " << bookId << endl;
-        }
+    vector<Slot> slots; // A power of two in size and at most 7/8 full
+    size_t count = 0;
+
+    static size_t hashOf(string_view bookId)
+    {
+        return std::hash<string_view>()(bookId);
     }
-    else
+
+    size_t mask() const
     {
-        cout << "Book not found." << endl;
+        return slots.size() - 1;
     }
-}
 
-void User::showHistory()
-{
-    if (account.history.empty())
+    // The slot holding `bookId`, or the empty slot that ends its probe sequence
+    size_t probe(string_view bookId, size_t hash) const
     {
-        cout << "No history to show" << endl;
+        size_t i = hash & mask();
+        while (slots[i].book && (slots[i].hash != hash || slots[i].book->bookId != bookId))
+            i = (i + 1) & mask();
+        return i;
     }
-    else
+
+    void rehash(size_t capacity)
     {
-        for (auto &i : account.history)
+        vector<Slot> old(capacity, Slot{0, nullptr});
+        old.swap(slots);
+        for (const Slot &slot : old)
         {
-            Booking *booking = i.second;
-            cout << "Booking ID: " << booking->bookingId << endl;
-            cout << "Booking Date: " << booking->bookingDate << endl;
-            cout << "Borrow Date: " << booking->borrowDate << endl;
-            cout << "Return Date: " << booking->returnDate << endl;
-            cout << "Fine: " << booking->fine << endl;
-            cout << "Booking Type: " << (booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow") << endl;
-            cout << "Book Title: " << booking->title << endl;
-            cout << "Book Author: " << booking->author << endl;
-            cout << "Book Publisher: " << booking->publisher << endl;
-            cout << "Book ISBN: " << booking->ISBN << endl;
-            cout << "Book Year: " << booking->year << endl;
-            cout << "----------------------------------------" << endl;
+            if (!slot.book)
+                continue;
+            size_t i = slot.hash & mask();
+            while (slots[i].book)
+                i = (i + 1) & mask();
+            slots[i] = slot;
         }
     }
-}
 
-bool User::authenticate(string pass)
-{
-    return pass == (this->password);
-}
-
-void Student::current_booking(string date)
-{
-    if (account.current.empty())
+public:
+    size_t size() const
     {
-        cout << "Nothing to show" << endl;
+        return count;
     }
-    else
+
+    bool empty() const
     {
-        for (auto &i : account.current)
-        {
-            Booking *booking = i.second;
-            if (booking->type != BookingType::RESERVED)
-                booking->fine = calculateFine(booking->borrowDate, date);
-            else
-                booking->fine = 0;
-            cout << "Booking ID: " << booking->bookingId << endl;
-            cout << "Booking Date: " << booking->bookingDate << endl;
-            cout << "Borrow Date: " << booking->borrowDate << endl;
-            cout << "Return Date: " << booking->returnDate << endl;
-            cout << "Fine: " << booking->fine << endl;
-            cout << "Booking Type: " << (booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow") << endl;
-            cout << "Book Title: " << booking->title << endl;
-            cout << "Book Author: " << booking->author << endl;
-            cout << "Book Publisher: " << booking->publisher << endl;
-            cout << "Book ISBN: " << booking->ISBN << endl;
-            cout << "Book Year: " << booking->year << endl;
-            cout << "----------------------------------------" << endl;
-        }
+        return count == 0;
     }
-}
-void Faculty::current_booking(string date)
-{
-    if (account.current.empty())
+
+    // Makes room for `n` books without further rehashing
+    void reserve(size_t n)
     {
-        cout << "Nothing to show" << endl;
+        size_t capacity = 16;
+        while (capacity / 8 * 7 < n)
+            capacity *= 2;
+        if (capacity > slots.size())
+            rehash(capacity);
     }
-    else
+
+    // The book with this ID, or nullptr
+    Book *find(string_view bookId) const
     {
-        for (auto &i : account.current)
-        {
-            Booking *booking = i.second;
-            booking->fine = 0;
-            cout << "Booking ID: " << booking->bookingId << endl;
-            cout << "Booking Date: " << booking->bookingDate << endl;
-            cout << "Borrow Date: " << booking->borrowDate << endl;
-            cout << "Return Date: " << booking->returnDate << endl;
-            cout << "Fine: " << booking->fine << endl;
-            cout << "Booking Type: " << (booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow") << endl;
-            cout << "Book Title: " << booking->title << endl;
-            cout << "Book Author: " << booking->author << endl;
-            cout << "Book Publisher: " << booking->publisher << endl;
-            cout << "Book ISBN: " << booking->ISBN << endl;
-            cout << "Book Year: " << booking->year << endl;
-            cout << "----------------------------------------" << endl;
-        }
+        if (count == 0)
+            return nullptr;
+        return slots[probe(bookId, hashOf(bookId))].book;
     }
-}
 
-void User::list_books()
-{
-    if (library.books.empty())
+    // Adds `book` under its ID, replacing any book already there
+    void insert(Book *book)
     {
-        cout << "No books available in the library." << endl;
+        reserve(count + 1);
+        size_t hash = hashOf(book->bookId);
+        Slot &slot = slots[probe(book->bookId, hash)];
+        if (!slot.book)
+            count++;
+        slot = Slot{hash, book};
     }
-    else
+
+    // Removes the book with this ID. The rest of its probe run shifts back into the hole,
+    // so no deleted markers are left behind to lengthen later probes.
+    bool erase(string_view bookId)
     {
-        cout << "List of all books in the library:" << endl;
-        cout << "----------------------------------------" << endl;
-        for (const auto &bookPair : library.books)
+        if (count == 0)
+            return false;
+        size_t hole = probe(bookId, hashOf(bookId));
+        if (!slots[hole].book)
+            return false;
+        for (size_t j = (hole + 1) & mask(); slots[j].book; j = (j + 1) & mask())
         {
-            const string &bookId = bookPair.first;
-            Book *book = bookPair.second;
-            cout << "Book ID: " << bookId << endl;
-            cout << "Title: " << book->title << endl;
-            cout << "Author: " << book->author << endl;
-            cout << "Publisher: " << book->publisher << endl;
-            cout << "ISBN: " << book->ISBN << endl;
-            cout << "Year: " << book->year << endl;
-            cout << "Status: " << (book->status == BookStatus::AVAILABLE ? "Available" : "Borrowed") << endl;
-            cout << "Reservations in queue: " << book->reservationQueue.size() << endl;
-            cout << "----------------------------------------" << endl;
+            // A book may fill the hole unless its home slot lies after the hole
+            size_t home = slots[j].hash & mask();
+            if (((j - home) & mask()) >= ((j - hole) & mask()))
+            {
+                slots[hole] = slots[j];
+                hole = j;
+            }
         }
+        slots[hole] = Slot{0, nullptr};
+        count--;
+        return true;
     }
-}
 
-// Student class functions
-Student::Student(string name, string ID, string password) : User(name, ID, password) {}
+    template <typename Visit>
+    void forEach(Visit visit) const
+    {
+        for (const Slot &slot : slots)
+            if (slot.book)
+                visit(slot.book);
+    }
 
-int Student::tell_fine(string returnDate)
-{
-    int total = 0;
-    for (auto i : this->account.current)
+    // The books in ID order, built on demand
+    vector<Book *> sorted() const
     {
-        Booking *booking = i.second;
-        if (booking->type != BookingType::RESERVED)
-            total += calculateFine(booking->bookingDate, returnDate);
+        vector<Book *> books;
+        books.reserve(count);
+        forEach([&](Book *book)
+                { books.push_back(book); });
+        sort(books.begin(), books.end(), [](const Book *a, const Book *b)
+             { return a->bookId < b->bookId; });
+        return books;
     }
-    return total;
-}
+};
 
-bool Student::isEligibleToBorrow(string date)
+// Roles of library users; each is a User subclass with its own borrowing policy
+enum class Role
 {
-    // Check if the student has a fine greater than 0
-    int totalFine = tell_fine(date); // Replace with actual date logic
-    if (totalFine > 0)
-    {
-        cout << "You have a total fine of " << totalFine << " rupees. Please pay the fine to borrow a book.\n";
-        return false;
-    }
+    STUDENT,
+    FACULTY,
+    LIBRARIAN
+};
 
-    // Check if the student has 3 or more books in their current map
-    if (account.current.size() >= 3)
+// Role as written in library_data.csv
+const char *roleName(Role role)
+{
+    switch (role)
     {
-        cout << "You have already borrowed or reserved " << account.current.size() << " books. Maximum of 3 books are allowed.\n";
-        return false;
+    case Role::STUDENT:
+        return "student";
+    case Role::FACULTY:
+        return "faculty";
+    case Role::LIBRARIAN:
+        return "librarian";
     }
+    return "";
+}
 
+bool parseRole(string_view name, Role &role)
+{
+    if (name == "student")
+        role = Role::STUDENT;
+    else if (name == "faculty")
+        role = Role::FACULTY;
+    else if (name == "librarian")
+        role = Role::LIBRARIAN;
+    else
+        return false;
     return true;
 }
 
-void Student::borrowBook(string date)
+struct UserEntry
 {
-    int fine = tell_fine(date);
-    if (isEligibleToBorrow(date) == false)
-        return;
-    cout << "Enter the book ID that you want to borrow: ";
-    string bookId;
-    cin >> bookId;
+    Role role;
+    User *user;
+};
 
-    if (library.books.count(bookId))
-    {
-        Book *book = library.books[bookId];
+class Library
+{
+public:
+    BookCatalog books;
+    map<string, Book *> deletedBooks;       // Tombstones that history bookings still refer to
+    unordered_map<string, UserEntry> users; // Every user by ID, with their role
 
-        // Cast BookStatus to int for the switch statement
-        switch (static_cast<int>(book->status))
-        {
-        case static_cast<int>(BookStatus::AVAILABLE):
-        {
-            cout << "The book is available. Do you want to borrow it? (yes/no): ";
-            string choice;
-            cin >> choice;
+    // The user registered under `userId`, or nullptr; a lookup never inserts
+    const UserEntry *findEntry(const string &userId) const
+    {
+        auto it = users.find(userId);
+        return it == users.end() ? nullptr : &it->second;
+    }
 
-            if (choice == "yes")
-            {
-                string bookingId = generateUniqueId();
-                Booking *newBooking = new Booking(
-                    bookingId, date, date, "N/A", 0, BookingType::DIRECT_BORROW, book->bookId,
-                    book->title, book->author, book->publisher, book->ISBN, book->year);
+    // Users ordered by role, then ID, as they are listed and saved
+    vector<const UserEntry *> usersByRole() const
+    {
+        vector<const UserEntry *> ordered;
+        ordered.reserve(users.size());
+        for (const auto &entry : users)
+            ordered.push_back(&entry.second);
+        sort(ordered.begin(), ordered.end(), [](const UserEntry *a, const UserEntry *b)
+             { return a->role != b->role ? a->role < b->role : a->user->UniqueId < b->user->UniqueId; });
+        return ordered;
+    }
+};
 
-                account.current[bookingId] = newBooking;
-                book->status = BookStatus::BORROWED;
+// Global library instance
+Library library;
 
-                cout << "Book borrowed successfully! Booking ID: " << bookingId << endl;
-            }
-            else
-            {
-                cout << "Borrowing cancelled." << endl;
-            }
-            break;
-        }
+// Runs task(0) .. task(count - 1) on a thread per core; each worker takes the next
+// index until none are left
+void parallelFor(size_t count, const function<void(size_t)> &task)
+{
+    atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < count; i = next++)
+            task(i);
+    };
+    size_t threadCount = min<size_t>(max(1u, thread::hardware_concurrency()), count);
+    vector<thread> workers;
+    for (size_t t = 1; t < threadCount; t++)
+        workers.emplace_back(work);
+    work();
+    for (thread &worker : workers)
+        worker.join();
+}
 
-        case static_cast<int>(BookStatus::BORROWED):
-        {
-            cout << "The book is currently borrowed. Do you want to reserve it? (yes/no): ";
-            string choice;
-            cin >> choice;
+// What a history query groups loans by
+enum class HistoryGroup
+{
+    BOOK,
+    USER,
+    ROLE,
+    MONTH,
+    YEAR
+};
 
-            if (choice == "yes")
-            {
-                book->reservationQueue.push_back(this->UniqueId);
-                string bookingId = generateUniqueId();
-                Booking *newBooking = new Booking(
-                    bookingId, date, "N/A", "N/A", 0, BookingType::RESERVED, book->bookId,
-                    book->title, book->author, book->publisher, book->ISBN, book->year);
-
-                account.current[bookingId] = newBooking;
-                cout << "Book reserved successfully! Booking ID: " << bookingId << endl;
-            }
-            else
-            {
-                cout << "Reservation cancelled." << endl;
-            }
-            break;
-        }
+// Which loans a history query reads: a window of borrow or return dates (unset ends are
+// open) and optionally one role
+struct HistoryFilter
+{
+    Date from, to; // from <= date < to
+    bool byReturnDate = false;
+    bool anyRole = true;
+    Role role = Role::STUDENT;
+};
 
-        default:
-            cout << "Invalid book status." << endl;
-            break;
-        }
-    }
-    else
-    {
-        cout << "Book not found." << endl;
-    }
-}
+// One group of a history query
+struct HistoryAggregate
+{
+    string label;
+    string title; // Book groups only
+    long long loans = 0;
+    long long loanDays = 0;
+    long long fines = 0;
+};
 
-void Student::returnBook(string date)
+// Returned loans kept column by column for analytics. Rows are appended as bookings
+// enter borrowing history and are never moved; when a booking leaves history (its user
+// is deleted, or replay replaces it) its row is only marked dead. Books and users are
+// stored as integer keys into dictionaries, dates as day numbers.
+class HistoryStore
 {
-    if (account.current.empty())
+    static constexpr size_t blockRows = 4096; // Rows filtered at a time
+
+    // Keyed by object, as hashing the pointer is cheaper than hashing the ID. A pool slot
+    // can be reused by another book or user, so objects are forgotten when they are freed.
+    unordered_map<const void *, uint32_t> bookKeys, userKeys;
+    vector<string> bookIds, bookTitles, userIds;
+
+    vector<uint32_t> bookKey, userKey;
+    vector<int32_t> borrowDay, returnDay, fine;
+    vector<uint8_t> role, live;
+    size_t liveRows = 0;
+    mutable shared_mutex lock; // Server sessions return books concurrently
+
+    static uint32_t keyOf(unordered_map<const void *, uint32_t> &keys, vector<string> &labels, const void *object,
+                          const string &label)
     {
-        cout << "There is nothing to return.\n";
-        return;
+        auto inserted = keys.emplace(object, static_cast<uint32_t>(labels.size()));
+        if (inserted.second)
+            labels.push_back(label);
+        return inserted.first->second;
     }
 
-    int num = 0;
-    cout << "Books available for return:\n";
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-    cout << "No. | Booking ID | Book Title          | Fine | Type\n";
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-    for (auto &i : account.current)
+    static int32_t monthOf(int32_t day)
     {
-        Booking *booking = i.second;
-        if (booking->type != BookingType::RESERVED)
-            booking->fine = calculateFine(booking->borrowDate, date);
-        else
-            booking->fine = 0;
-        cout << num << " | "
-             << booking->bookingId << " | "
-             << booking->title << " | "
-             << booking->fine << " | "
-             << (booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow") << endl;
-        num++;
+        int year, month, dayOfMonth;
+        Date(day).toCivil(year, month, dayOfMonth);
+        return year * 12 + month - 1;
     }
-    cout << "--------------------------------------------------------------------------------------------------------\n";
 
-    cout << "Enter the number of the book you want to return: ";
-    int choice;
-    cin >> choice;
+public:
+    static constexpr uint32_t noRow = UINT32_MAX;
 
-    if (choice < 0 || choice >= account.current.size())
+    // Appends a returned loan and returns its row
+    uint32_t append(const Book *book, const User *user, Role userRole, Date borrowDate, Date returnDate, int charged)
     {
-        cout << "Invalid choice. Return failed.\n";
-        return;
+        unique_lock<shared_mutex> guard(lock);
+        uint32_t row = static_cast<uint32_t>(live.size());
+        uint32_t key = keyOf(bookKeys, bookIds, book, book->bookId);
+        if (key == bookTitles.size())
+            bookTitles.push_back(book->title);
+        bookKey.push_back(key);
+        userKey.push_back(keyOf(userKeys, userIds, user, user->UniqueId));
+        borrowDay.push_back(borrowDate.days());
+        returnDay.push_back(returnDate.days());
+        fine.push_back(charged);
+        role.push_back(static_cast<uint8_t>(userRole));
+        live.push_back(1);
+        liveRows++;
+        return row;
     }
 
-    auto it = account.current.begin();
-    advance(it, choice);
-    Booking *booking = it->second;
+    // Makes room for `rows` more rows, so a load does not copy the columns as they grow
+    void reserve(size_t rows)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        rows += live.size();
+        for (auto *column : {&bookKey, &userKey})
+            column->reserve(rows);
+        for (auto *column : {&borrowDay, &returnDay, &fine})
+            column->reserve(rows);
+        role.reserve(rows);
+        live.reserve(rows);
+    }
 
-    if (booking->type == BookingType::RESERVED)
+    void retract(uint32_t row)
     {
-        Book *book = library.books[booking->bookId];
-        auto reservationIt = find(book->reservationQueue.begin(), book->reservationQueue.end(), this->UniqueId);
-        if (reservationIt != book->reservationQueue.end())
+        unique_lock<shared_mutex> guard(lock);
+        if (row < live.size() && live[row])
         {
-            book->reservationQueue.erase(reservationIt);
-            cout << "Reservation cancelled successfully.\n";
-        }
-        else
-        {
-            cout << "Reservation not found. Return failed.\n";
+            live[row] = 0;
+            liveRows--;
         }
     }
-    else if (booking->type == BookingType::DIRECT_BORROW)
+
+    // Called as a book or user is freed; their rows keep their key and label
+    void forget(const Book *book)
     {
-        booking->returnDate = date;
-        int fine = calculateFine(booking->borrowDate, booking->returnDate);
-        if (fine > 0)
-        {
-            cout << "You have a fine of " << fine << " rupees. Do you want to pay it? (yes/no): ";
-            string payChoice;
-            cin >> payChoice;
+        unique_lock<shared_mutex> guard(lock);
+        bookKeys.erase(book);
+    }
 
-            if (payChoice != "yes")
-            {
-                cout << "Return failed. Please pay the fine to return the book.\n";
-                return;
-            }
+    void forget(const User *user)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        userKeys.erase(user);
+    }
 
-            booking->fine = fine;
-            cout << "Fine paid successfully.\n";
-        }
+    void clear()
+    {
+        unique_lock<shared_mutex> guard(lock);
+        bookKeys.clear();
+        userKeys.clear();
+        for (auto *labels : {&bookIds, &bookTitles, &userIds})
+            labels->clear();
+        for (auto *column : {&bookKey, &userKey})
+            column->clear();
+        for (auto *column : {&borrowDay, &returnDay, &fine})
+            column->clear();
+        role.clear();
+        live.clear();
+        liveRows = 0;
+    }
 
-        cout << "Book returned successfully.\n";
+    size_t size() const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        return liveRows;
+    }
 
-        Book *book = library.books[booking->bookId];
-        while (!book->reservationQueue.empty())
+    // Totals the loans that pass `filter` for each group, ordered by group key (books and
+    // users in the order they first appeared). The rows are split between the cores; each
+    // worker filters a block of rows into a mask in one branch-free pass over the date,
+    // role and live columns, then adds the selected rows to its own totals.
+    vector<HistoryAggregate> aggregate(const HistoryFilter &filter, HistoryGroup group) const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        size_t rows = live.size();
+        const int32_t unset = Date().days();
+        int32_t from = filter.from.isSet() ? filter.from.days() : unset + 1;
+        int32_t to = filter.to.isSet() ? filter.to.days() : INT32_MAX;
+        const vector<int32_t> &windowDay = filter.byReturnDate ? returnDay : borrowDay;
+        uint8_t wantedRole = static_cast<uint8_t>(filter.role);
+        uint8_t anyRole = filter.anyRole;
+
+        // Dense group keys: months and years are offset from the earliest one in range
+        int32_t firstMonth = 0;
+        size_t groups = 0;
+        switch (group)
         {
-            string nextUserId = book->reservationQueue.front();
-            User *nextUser = nullptr;
-
-            if (library.students.count(nextUserId))
-            {
-                nextUser = library.students[nextUserId];
-            }
-            else if (library.faculties.count(nextUserId))
-            {
-                nextUser = library.faculties[nextUserId];
-            }
-
-            if (nextUser)
+        case HistoryGroup::BOOK:
+            groups = bookIds.size();
+            break;
+        case HistoryGroup::USER:
+            groups = userIds.size();
+            break;
+        case HistoryGroup::ROLE:
+            groups = 3;
+            break;
+        case HistoryGroup::MONTH:
+        case HistoryGroup::YEAR:
+            if (rows > 0)
             {
-                // Check if the next user is eligible to borrow the book
-                bool isEligible = false;
-                if (library.userTypes[nextUserId] == "student")
-                {
-                    // cout<<"i am here\n";
-                    isEligible = static_cast<Student *>(nextUser)->isEligibleToBorrow(date);
-                    cout << isEligible << endl;
-                }
-                else if (library.userTypes[nextUserId] == "faculty")
+                auto range = minmax_element(windowDay.begin(), windowDay.end());
+                firstMonth = monthOf(max(*range.first, from));
+                int32_t lastMonth = monthOf(min(*range.second, to == INT32_MAX ? *range.second : to - 1));
+                if (group == HistoryGroup::YEAR)
                 {
-                    isEligible = static_cast<Faculty *>(nextUser)->isEligibleToBorrow(date);
+                    firstMonth -= firstMonth % 12;
+                    groups = lastMonth >= firstMonth ? (lastMonth - firstMonth) / 12 + 1 : 0;
                 }
+                else
+                    groups = lastMonth >= firstMonth ? lastMonth - firstMonth + 1 : 0;
+            }
+            break;
+        }
 
-                if (isEligible)
-                {
-                    // Find the reservation booking in the next user's current map
-                    for (auto &bookingPair : nextUser->account.current)
+        size_t workers = min<size_t>(max(1u, thread::hardware_concurrency()), rows / (16 * blockRows) + 1);
+        vector<vector<HistoryAggregate>> partial(workers, vector<HistoryAggregate>(groups));
+        parallelFor(workers, [&](size_t w)
                     {
-                        Booking *reservationBooking = bookingPair.second;
-                        if (reservationBooking->type == BookingType::RESERVED && reservationBooking->bookId == book->bookId)
-                        {
-                            // Update the reservation booking to DIRECT_BORROW
-                            reservationBooking->type = BookingType::DIRECT_BORROW;
-                            reservationBooking->borrowDate = date;
-                            reservationBooking->returnDate = "N/A";
-                            reservationBooking->fine = 0;
-
-                            book->status = BookStatus::BORROWED;
-                            cout << "Reservation converted to borrow for user: " << nextUserId << endl;
-                            book->reservationQueue.erase(book->reservationQueue.begin());
-                            account.history[booking->bookingId] = booking;
-                            account.current.erase(it);
-                            return;
-                        }
-                    }
-                }
-                else
+            vector<HistoryAggregate> &totals = partial[w];
+            uint8_t mask[blockRows];
+            size_t end = rows * (w + 1) / workers;
+            for (size_t begin = rows * w / workers; begin < end; begin += blockRows)
+            {
+                size_t count = min(blockRows, end - begin);
+                const int32_t *day = windowDay.data() + begin;
+                const uint8_t *alive = live.data() + begin;
+                const uint8_t *roles = role.data() + begin;
+                for (size_t i = 0; i < count; i++)
+                    mask[i] = alive[i] & (day[i] >= from) & (day[i] < to) & (anyRole | (roles[i] == wantedRole));
+
+                for (size_t i = 0; i < count; i++)
                 {
-                    // Remove ineligible user from the reservation queue and their current map
-                    book->reservationQueue.erase(book->reservationQueue.begin());
-                    for (auto &bookingPair : nextUser->account.current)
+                    if (!mask[i])
+                        continue;
+                    size_t row = begin + i;
+                    size_t key = 0;
+                    switch (group)
                     {
-                        Booking *reservationBooking = bookingPair.second;
-                        if (reservationBooking->type == BookingType::RESERVED && reservationBooking->bookId == book->bookId)
-                        {
-                            nextUser->account.current.erase(bookingPair.first);
-                            break;
-                        }
+                    case HistoryGroup::BOOK:
+                        key = bookKey[row];
+                        break;
+                    case HistoryGroup::USER:
+                        key = userKey[row];
+                        break;
+                    case HistoryGroup::ROLE:
+                        key = role[row];
+                        break;
+                    case HistoryGroup::MONTH:
+                        key = monthOf(day[i]) - firstMonth;
+                        break;
+                    case HistoryGroup::YEAR:
+                        key = (monthOf(day[i]) - firstMonth) / 12;
+                        break;
                     }
-                    cout << "User " << nextUserId << " is ineligible. Removed from the reservation queue.\n";
+                    HistoryAggregate &total = totals[key];
+                    total.loans++;
+                    total.loanDays += returnDay[row] - borrowDay[row];
+                    total.fines += fine[row];
                 }
+            } });
+
+        vector<HistoryAggregate> result(groups);
+        for (size_t key = 0; key < groups; key++)
+        {
+            HistoryAggregate &total = result[key];
+            for (const auto &totals : partial)
+            {
+                total.loans += totals[key].loans;
+                total.loanDays += totals[key].loanDays;
+                total.fines += totals[key].fines;
             }
-            else
+            switch (group)
             {
-                // Remove invalid user from the reservation queue
-                book->reservationQueue.erase(book->reservationQueue.begin());
-                cout << "User " << nextUserId << " not found. Removed from the reservation queue.\n";
+            case HistoryGroup::BOOK:
+                total.label = bookIds[key];
+                total.title = bookTitles[key];
+                break;
+            case HistoryGroup::USER:
+                total.label = userIds[key];
+                break;
+            case HistoryGroup::ROLE:
+                total.label = roleName(static_cast<Role>(key));
+                break;
+            case HistoryGroup::MONTH:
+            case HistoryGroup::YEAR:
+            {
+                int month = firstMonth + static_cast<int>(group == HistoryGroup::YEAR ? key * 12 : key);
+                ostringstream label;
+                label << month / 12;
+                if (group == HistoryGroup::MONTH)
+                    label << "-" << setw(2) << setfill('0') << month % 12 + 1;
+                total.label = label.str();
+                break;
+            }
             }
         }
+        result.erase(remove_if(result.begin(), result.end(), [](const HistoryAggregate &total)
+                               { return total.loans == 0; }),
+                     result.end());
+        return result;
+    }
 
-        // If no eligible user is found, mark the book as available
-        book->status = BookStatus::AVAILABLE;
-        cout << "No eligible reservations left. Book is now available.\n";
+    // The `k` groups with the most loans, ties broken by label
+    vector<HistoryAggregate> top(const HistoryFilter &filter, HistoryGroup group, size_t k) const
+    {
+        vector<HistoryAggregate> groups = aggregate(filter, group);
+        auto more = [](const HistoryAggregate &a, const HistoryAggregate &b)
+        { return a.loans != b.loans ? a.loans > b.loans : a.label < b.label; };
+        k = min(k, groups.size());
+        partial_sort(groups.begin(), groups.begin() + k, groups.end(), more);
+        groups.resize(k);
+        return groups;
     }
+};
 
-    account.history[booking->bookingId] = booking;
-    account.current.erase(it);
+// Global history store; Account keeps it in step with the returned loans in `history`
+HistoryStore historyStore;
+
+void recordHistory(Booking *booking)
+{
+    booking->historyRow = HistoryStore::noRow;
+    if (booking->type != BookingType::DIRECT_BORROW || !booking->borrowDate.isSet() || !booking->returnDate.isSet())
+        return; // Cancelled reservations are not loans
+    const User *user = booking->user;
+    Role userRole = dynamic_cast<const Faculty *>(user) ? Role::FACULTY : Role::STUDENT;
+    booking->historyRow = historyStore.append(booking->book, user, userRole, booking->borrowDate, booking->returnDate,
+                                              user->paysFines() ? booking->fine : 0);
 }
 
-void Student::login()
+void retractHistory(const Booking *booking)
 {
-    cout << "Student logged in successfully. Welcome, " << name << "!\n";
-    string date;
-    cout << "Enter today's date (DDMMYYYY): ";
-    cin >> date;
-    while (true)
+    if (booking->historyRow != HistoryStore::noRow)
+        historyStore.retract(booking->historyRow);
+}
+
+// Slab allocator for one entity type. Objects never move once created, so a pointer
+// stays valid until destroy(); freed slots are reused before a new slab is allocated,
+// and trim() hands slabs that no longer hold any object back to the system.
+template <typename T>
+class ObjectPool
+{
+    static const size_t slabSize = 256; // Objects per slab
+
+    union Slot
     {
-        cout << "\nWhat would you like to do?\n";
-        cout << "1. Borrow Book\n";
-        cout << "2. Return Book\n";
-        cout << "3. View Booking History\n";
-        cout << "4. View Current Booking Status\n";
-        cout << "5. List Books in Library\n";
-        cout << "6. Log Out\n";
-        cout << "Enter your choice: \n";
+        Slot *nextFree;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
 
-        int choice;
-        cin >> choice;
+    struct Slab
+    {
+        Slot slots[slabSize];
+    };
 
-        switch (choice)
-        {
-        case 1:
+    const char *name;
+    map<const Slot *, unique_ptr<Slab>> slabs; // Keyed by the first slot
+    Slot *freeList = nullptr;
+    size_t live = 0, peak = 0;
+    mutex lock; // Server sessions create and destroy bookings concurrently
+
+public:
+    explicit ObjectPool(const char *name) : name(name) {}
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        Slot *slot;
         {
-            borrowBook(date);
-            break;
+            lock_guard<mutex> guard(lock);
+            if (!freeList)
+            {
+                unique_ptr<Slab> slab(new Slab);
+                for (size_t i = slabSize; i-- > 0;)
+                {
+                    slab->slots[i].nextFree = freeList;
+                    freeList = &slab->slots[i];
+                }
+                slabs.emplace(&slab->slots[0], move(slab));
+            }
+            slot = freeList;
+            freeList = slot->nextFree;
+            peak = max(peak, ++live);
         }
-        case 2:
+        return new (slot->storage) T(forward<Args>(args)...);
+    }
+
+    void destroy(T *object)
+    {
+        if (!object)
+            return;
+        object->~T();
+        Slot *slot = reinterpret_cast<Slot *>(object);
+        lock_guard<mutex> guard(lock);
+        slot->nextFree = freeList;
+        freeList = slot;
+        live--;
+    }
+
+    // Releases every slab whose slots are all free
+    void trim()
+    {
+        lock_guard<mutex> guard(lock);
+        vector<pair<const Slot *, Slot *>> freeSlots; // (slab, slot) in free-list order
+        map<const Slot *, size_t> freeCount;
+        for (Slot *slot = freeList; slot; slot = slot->nextFree)
         {
-            returnBook(date);
-            break;
+            const Slot *slab = prev(slabs.upper_bound(slot))->first;
+            freeSlots.emplace_back(slab, slot);
+            freeCount[slab]++;
         }
-        case 3:
-            showHistory();
-            break;
-        case 4:
-            current_booking(date);
-            break;
-        case 5:
-            list_books();
-            break;
-        case 6:
-            cout << "Logging out...\n";
-            return;
-        default:
-            cout << "Invalid choice. Please try again.\n";
+
+        freeList = nullptr;
+        for (auto it = freeSlots.rbegin(); it != freeSlots.rend(); ++it)
+        {
+            if (freeCount[it->first] == slabSize)
+                continue;
+            it->second->nextFree = freeList;
+            freeList = it->second;
         }
+        for (const auto &[slab, count] : freeCount)
+            if (count == slabSize)
+                slabs.erase(slab);
     }
-}
-
-// Faculty class functions
-Faculty::Faculty(string name, string ID, string password) : User(name, ID, password) {}
 
-bool Faculty::isEligibleToBorrow(string date)
-{
-    // Check if the faculty has 5 or more books in their current map
-    if (account.current.size() >= 5)
+    void report(ostream &out)
     {
-        cout << "You have already borrowed or reserved " << account.current.size() << " books. Maximum of 5 books are allowed.\n";
-        return false;
+        lock_guard<mutex> guard(lock);
+        out << left << setw(10) << name << right << setw(10) << live << setw(10) << peak
+            << setw(10) << slabs.size() * slabSize << setw(8) << sizeof(T)
+            << setw(14) << slabs.size() * sizeof(Slab) << "\n";
     }
+};
 
-    // Check if the faculty has any book borrowed more than 90 days ago
-    string currentDate = date; // Replace with actual date logic
-    for (auto &bookingPair : account.current)
+// Entity storage: the library owns its books and users through these pools, and each
+// Account owns the bookings in its current and history maps
+ObjectPool<Book> bookPool("Book");
+ObjectPool<Booking> bookingPool("Booking");
+ObjectPool<Student> studentPool("Student");
+ObjectPool<Faculty> facultyPool("Faculty");
+ObjectPool<Librarian> librarianPool("Librarian");
+
+// Allocates a user of the given role without registering them; `credential` is a
+// password hash (see hashPassword)
+User *newUser(Role role, const string &name, const string &userId, const string &credential)
+{
+    User *user = nullptr;
+    switch (role)
     {
-        Booking *booking = bookingPair.second;
-        int daysSinceBorrowed = 0;
-        if (booking->type != BookingType::RESERVED)
-            daysSinceBorrowed = daysBetweenDates(booking->borrowDate, currentDate);
-        if (daysSinceBorrowed > 90)
-        {
-            cout << "You have a book borrowed more than 90 days ago. Please return it to borrow a new book.\n";
-            return false;
-        }
+    case Role::STUDENT:
+        user = studentPool.create(name, userId, credential);
+        break;
+    case Role::FACULTY:
+        user = facultyPool.create(name, userId, credential);
+        break;
+    case Role::LIBRARIAN:
+        user = librarianPool.create(name, userId, credential);
+        break;
     }
+    return user;
+}
 
-    return true;
+// Creates a user of the given role and registers them under their ID
+User *createUser(Role role, const string &name, const string &userId, const string &credential)
+{
+    User *user = newUser(role, name, userId, credential);
+    library.users[userId] = UserEntry{role, user};
+    return user;
 }
 
-void Faculty::borrowBook(string date)
+// Removes a user from the library and frees them along with every booking they own
+void destroyUser(const string &userId)
 {
-    if (isEligibleToBorrow(date) == false)
+    auto it = library.users.find(userId);
+    if (it == library.users.end())
         return;
-    cout << "Enter the book ID that you want to borrow: ";
-    string bookId;
-    cin >> bookId;
 
-    if (library.books.count(bookId))
+    User *user = it->second.user;
+    while (!user->account.current.empty())
+        bookingPool.destroy(user->account.removeCurrent(user->account.current.begin()->first));
+    for (auto &entry : user->account.history)
     {
-        Book *book = library.books[bookId];
-
-        switch (static_cast<int>(book->status))
-        {
-        case static_cast<int>(BookStatus::AVAILABLE):
-        {
-            cout << "The book is available. Do you want to borrow it? (yes/no): ";
-            string choice;
-            cin >> choice;
+        retractHistory(entry.second);
+        bookingPool.destroy(entry.second);
+    }
+    historyStore.forget(user);
+    endSessions(user);
 
-            if (choice == "yes")
-            {
-                string bookingId = generateUniqueId();
-                Booking *newBooking = new Booking(
-                    bookingId, date, date, "N/A", 0, BookingType::DIRECT_BORROW, book->bookId,
-                    book->title, book->author, book->publisher, book->ISBN, book->year);
+    switch (it->second.role)
+    {
+    case Role::STUDENT:
+        studentPool.destroy(static_cast<Student *>(user));
+        break;
+    case Role::FACULTY:
+        facultyPool.destroy(static_cast<Faculty *>(user));
+        break;
+    case Role::LIBRARIAN:
+        librarianPool.destroy(static_cast<Librarian *>(user));
+        break;
+    }
+    library.users.erase(it);
+}
 
-                account.current[bookingId] = newBooking;
-                book->status = BookStatus::BORROWED;
+// Returns the slabs emptied by deletions; run when the journal is compacted
+void trimPools()
+{
+    bookPool.trim();
+    bookingPool.trim();
+    studentPool.trim();
+    facultyPool.trim();
+    librarianPool.trim();
+}
 
-                cout << "Book borrowed successfully! Booking ID: " << bookingId << endl;
-            }
-            else
-            {
-                cout << "Borrowing cancelled." << endl;
-            }
-            break;
-        }
+void printMemoryReport(ostream &out)
+{
+    out << "Memory usage by entity type (object storage only)\n";
+    out << left << setw(10) << "Type" << right << setw(10) << "Live" << setw(10) << "Peak"
+        << setw(10) << "Slots" << setw(8) << "Size" << setw(14) << "Bytes" << "\n";
+    bookPool.report(out);
+    bookingPool.report(out);
+    studentPool.report(out);
+    facultyPool.report(out);
+    librarianPool.report(out);
+}
 
-        case static_cast<int>(BookStatus::BORROWED):
-        {
-            cout << "The book is currently borrowed. Do you want to reserve it? (yes/no): ";
-            string choice;
-            cin >> choice;
+// Kinds of change journal records; each one carries a row in the library_data.csv layout
+enum class JournalOp
+{
+    BOOK,
+    DELETE_BOOK,
+    USER,
+    DELETE_USER,
+    CURRENT_BOOKING,
+    HISTORY_BOOKING,
+    DROP_BOOKING
+};
+
+const char *journalTag(JournalOp op)
+{
+    switch (op)
+    {
+    case JournalOp::BOOK:
+        return "Book";
+    case JournalOp::DELETE_BOOK:
+        return "DeleteBook";
+    case JournalOp::USER:
+        return "User";
+    case JournalOp::DELETE_USER:
+        return "DeleteUser";
+    case JournalOp::CURRENT_BOOKING:
+        return "Current";
+    case JournalOp::HISTORY_BOOKING:
+        return "History";
+    case JournalOp::DROP_BOOKING:
+        return "Drop";
+    }
+    return "";
+}
+
+// When a commit is acknowledged relative to reaching the disk
+enum class Durability
+{
+    NONE,   // Written to the OS only; survives a crash of the program but not of the machine
+    COMMIT, // Each commit waits for its own fdatasync
+    GROUP   // Commits wait for a shared fdatasync that a flusher thread issues for all of them
+};
 
-            if (choice == "yes")
+// Write-ahead log of the changes made since library_data.csv was last written.
+// Records hold the new state of whatever a mutation touched, so replaying them is
+// idempotent and each commit costs O(change) rather than O(library). A mutation that
+// writes several records is framed by Begin and Commit lines, and replay drops a
+// transaction whose Commit never reached the disk.
+class Journal
+{
+    int fd = -1;
+    atomic<size_t> records{0}; // Records written since the last compaction
+    mutex writeLock;    // Serializes commits from server sessions
+
+    // Records of the mutation in progress on this thread
+    static thread_local string pending;
+    static thread_local size_t pendingRecords;
+
+    // The last commit of this thread that is written but may not be durable yet (0 if none)
+    static thread_local unsigned long long owedTicket;
+
+    Durability durability = Durability::GROUP;
+    chrono::milliseconds groupInterval{0};
+
+    // Group commit: commits are numbered as they are written, and the flusher publishes
+    // the highest number its last fdatasync covered
+    mutex syncLock;
+    condition_variable syncWanted, syncDone;
+    unsigned long long written = 0, synced = 0;
+    bool stopping = false;
+    thread flusher;
+    atomic<size_t> commits{0}, syncs{0};
+
+    void flushLoop()
+    {
+        unique_lock<mutex> guard(syncLock);
+        while (true)
+        {
+            syncWanted.wait(guard, [this]
+                            { return stopping || written > synced; });
+            if (written == synced)
+                return; // Stopping with nothing left to sync
+            if (groupInterval.count() > 0 && !stopping)
             {
-                book->reservationQueue.push_back(this->UniqueId);
-                string bookingId = generateUniqueId();
-                Booking *newBooking = new Booking(
-                    bookingId, date, "N/A", "N/A", 0, BookingType::RESERVED, book->bookId,
-                    book->title, book->author, book->publisher, book->ISBN, book->year);
-
-                account.current[bookingId] = newBooking;
-                cout << "Book reserved successfully! Booking ID: " << bookingId << endl;
+                // Let more commits join this group
+                guard.unlock();
+                this_thread::sleep_for(groupInterval);
+                guard.lock();
             }
-            else
+            unsigned long long target = written;
+            guard.unlock();
+            if (fdatasync(fd) != 0)
+                cerr << "Error: Could not sync the journal\n";
+            syncs++;
+            guard.lock();
+            synced = target;
+            syncDone.notify_all();
+        }
+    }
+
+public:
+    static const size_t compactionThreshold = 10000;
+
+    ~Journal()
+    {
+        close();
+    }
+
+    // Takes effect when the journal is opened
+    void setDurability(Durability level, chrono::milliseconds interval)
+    {
+        durability = level;
+        groupInterval = interval;
+    }
+
+    // Opens the journal for appending, discarding anything past `validLength` (a torn final
+    // record or an unfinished transaction)
+    void open(const string &path, off_t validLength, size_t replayedRecords)
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0)
+        {
+            cerr << "Error: Could not open " << path << "\n";
+            return;
+        }
+        if (ftruncate(fd, validLength) != 0)
+            cerr << "Error: Could not truncate " << path << "\n";
+        records = replayedRecords;
+        if (durability == Durability::GROUP)
+            flusher = thread(&Journal::flushLoop, this);
+    }
+
+    void record(JournalOp op, const string &row)
+    {
+        pending += journalTag(op);
+        pending += ',';
+        pending += row;
+        pending += '\n';
+        pendingRecords++;
+    }
+
+    // Server sessions set this so commit() returns as soon as the records are written;
+    // the session calls awaitDurable() once it has released its locks, so commits from
+    // other sessions can join the same sync instead of queueing behind the lock
+    static thread_local bool deferDurability;
+
+    // Appends this thread's pending records with a single write, so the records of one
+    // mutation are never interleaved with another's, and (unless deferred) returns once
+    // the durability level is met
+    void commit()
+    {
+        if (pendingRecords == 0)
+            return;
+        if (pendingRecords > 1)
+            pending = "Begin\n" + pending + "Commit\n";
+        {
+            lock_guard<mutex> guard(writeLock);
+            records += pendingRecords;
+            const char *data = pending.data();
+            size_t remaining = pending.size();
+            while (fd >= 0 && remaining > 0)
             {
-                cout << "Reservation cancelled." << endl;
+                ssize_t count = write(fd, data, remaining);
+                if (count < 0)
+                {
+                    cerr << "Error: Could not write to the journal\n";
+                    break;
+                }
+                data += count;
+                remaining -= count;
             }
-            break;
         }
+        pendingRecords = 0;
+        pending.clear();
+        if (fd < 0)
+            return;
+        commits++;
+        if (durability == Durability::NONE)
+            return;
 
-        default:
-            cout << "Invalid book status." << endl;
-            break;
+        {
+            lock_guard<mutex> guard(syncLock);
+            owedTicket = ++written;
         }
+        if (durability == Durability::GROUP)
+            syncWanted.notify_one();
+        if (!deferDurability)
+            awaitDurable();
     }
-    else
+
+    // Waits until this thread's commits are on disk
+    void awaitDurable()
     {
-        cout << "Book not found." << endl;
+        if (owedTicket == 0)
+            return;
+        if (durability == Durability::COMMIT)
+        {
+            if (fdatasync(fd) != 0)
+                cerr << "Error: Could not sync the journal\n";
+            syncs++;
+        }
+        else
+        {
+            unique_lock<mutex> guard(syncLock);
+            syncDone.wait(guard, [this]
+                          { return synced >= owedTicket; });
+        }
+        owedTicket = 0;
+    }
+
+    // Empties the journal once its contents are part of the snapshot
+    void reset()
+    {
+        if (fd >= 0 && ftruncate(fd, 0) != 0)
+            cerr << "Error: Could not truncate the journal\n";
+        records = 0;
+    }
+
+    void close()
+    {
+        if (flusher.joinable())
+        {
+            {
+                lock_guard<mutex> guard(syncLock);
+                stopping = true;
+            }
+            syncWanted.notify_one();
+            flusher.join();
+        }
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
     }
+
+    size_t size() const { return records; }
+    size_t commitCount() const { return commits; }
+    size_t syncCount() const { return syncs; }
+    bool needsCompaction() const { return records >= compactionThreshold; }
+};
+
+thread_local string Journal::pending;
+thread_local size_t Journal::pendingRecords = 0;
+thread_local unsigned long long Journal::owedTicket = 0;
+thread_local bool Journal::deferDurability = false;
+
+// Global change journal
+Journal journal;
+
+// Parses a --durability level: none, commit, or group with an optional wait in ms (group:5)
+bool parseDurability(const string &text)
+{
+    if (text == "none")
+        journal.setDurability(Durability::NONE, chrono::milliseconds(0));
+    else if (text == "commit")
+        journal.setDurability(Durability::COMMIT, chrono::milliseconds(0));
+    else if (text == "group")
+        journal.setDurability(Durability::GROUP, chrono::milliseconds(0));
+    else if (text.rfind("group:", 0) == 0 && text.size() > 6 &&
+             all_of(text.begin() + 6, text.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); }))
+        journal.setDurability(Durability::GROUP, chrono::milliseconds(atoi(text.c_str() + 6)));
+    else
+        return false;
+    return true;
 }
 
-void Faculty::returnBook(string date)
+// Whether commitJournal() may compact; server mode compacts between commands instead
+bool compactOnCommit = true;
+
+// Hands out IDs as a per-kind prefix followed by a counter (B1000, S1000, ..., BK1000).
+// Every ID read at startup is observed, and each counter stays above the largest loaded
+// ID with its prefix, so allocation is O(1) and collision-free without remembering IDs.
+class IdAllocator
 {
-    if (account.current.empty())
+    static const int kindCount = 5;
+    atomic<unsigned long long> next[kindCount] = {1000, 1000, 1000, 1000, 1000};
+
+public:
+    static const char *prefix(IdKind kind)
     {
-        cout << "There is nothing to return.\n";
-        return;
+        switch (kind)
+        {
+        case IdKind::BOOK:
+            return "B";
+        case IdKind::STUDENT:
+            return "S";
+        case IdKind::FACULTY:
+            return "F";
+        case IdKind::LIBRARIAN:
+            return "L";
+        case IdKind::BOOKING:
+            return "BK";
+        }
+        return "";
     }
 
-    int num = 0;
-    cout << "Books available for return:\n";
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-    cout << "No. | Booking ID | Book Title          | Fine | Type\n";
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-    for (auto &i : account.current)
+    static string format(IdKind kind, unsigned long long value)
     {
-        Booking *booking = i.second;
-        booking->fine = calculateFine(booking->borrowDate, date);
-        cout << num << " | "
-             << booking->bookingId << " | "
-             << booking->title << " | "
-             << booking->fine << " | "
-             << (booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow") << endl;
-        num++;
+        return prefix(kind) + to_string(value);
     }
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-
-    cout << "Enter the number of the book you want to return: ";
-    int choice;
-    cin >> choice;
 
-    if (choice < 0 || choice >= account.current.size())
+    string allocate(IdKind kind)
     {
-        cout << "Invalid choice. Return failed.\n";
-        return;
+        return format(kind, next[static_cast<int>(kind)].fetch_add(1));
     }
 
-    auto it = account.current.begin();
-    advance(it, choice);
-    Booking *booking = it->second;
+    // Reserves `count` consecutive IDs at once and returns the first counter value
+    unsigned long long allocateBlock(IdKind kind, size_t count)
+    {
+        return next[static_cast<int>(kind)].fetch_add(count);
+    }
 
-    if (booking->type == BookingType::RESERVED)
+    // Moves the counter past `id` if it has this kind's prefix followed only by digits
+    void observe(IdKind kind, string_view id)
     {
-        Book *book = library.books[booking->bookId];
-        auto reservationIt = find(book->reservationQueue.begin(), book->reservationQueue.end(), this->UniqueId);
-        if (reservationIt != book->reservationQueue.end())
+        string_view pre = prefix(kind);
+        if (id.size() <= pre.size() || id.size() > pre.size() + 18 || id.substr(0, pre.size()) != pre)
+            return;
+        unsigned long long value = 0;
+        for (char c : id.substr(pre.size()))
         {
-            book->reservationQueue.erase(reservationIt);
-            cout << "Reservation cancelled successfully.\n";
+            if (c < '0' || c > '9')
+                return;
+            value = value * 10 + (c - '0');
         }
-        else
+        // The parallel loader observes IDs from several threads at once
+        atomic<unsigned long long> &counter = next[static_cast<int>(kind)];
+        unsigned long long current = counter.load();
+        while (current <= value && !counter.compare_exchange_weak(current, value + 1))
         {
-            cout << "Reservation not found. Return failed.\n";
         }
     }
-    else if (booking->type == BookingType::DIRECT_BORROW)
+};
+
+// Global ID allocator
+IdAllocator idAllocator;
+
+// Filters and paging for a catalog search; empty text or ISBN means "any"
+struct SearchQuery
+{
+    string text;
+    string ISBN;
+    int yearFrom = INT_MIN;
+    int yearTo = INT_MAX;
+    bool filterStatus = false;
+    BookStatus status = BookStatus::AVAILABLE;
+    size_t page = 0;
+    size_t pageSize = 10;
+};
+
+struct SearchHit
+{
+    Book *book;
+    int score;
+};
+
+struct SearchResult
+{
+    vector<SearchHit> hits; // The requested page, best match first
+    size_t total = 0;       // Matches across all pages
+};
+
+// Search index over library.books: an inverted index of title/author/publisher tokens,
+// exact ISBN lookup and a year index. Every query token must match (AND); hits are
+// ranked by where the tokens matched (title over author over publisher). Books are
+// indexed incrementally as they are added or deleted; status and year are read from
+// the Book itself, so borrowing and returning never touch the index.
+class CatalogSearch
+{
+    enum Field : uint8_t
+    {
+        TITLE = 1,
+        AUTHOR = 2,
+        PUBLISHER = 4
+    };
+
+    struct Posting
+    {
+        uint32_t doc;
+        uint8_t fields;
+    };
+
+    vector<Book *> docs; // Document number -> book, nullptr once deleted
+    unordered_map<string, uint32_t> docOf;
+    unordered_map<string, vector<Posting>> postings; // Sorted by document number
+    unordered_map<string, vector<uint32_t>> byISBN; // Copies of a book share an ISBN
+    multimap<int, uint32_t> byYear;
+    size_t deleted = 0;
+
+    static int fieldScore(uint8_t fields)
+    {
+        return (fields & TITLE ? 3 : 0) + (fields & AUTHOR ? 2 : 0) + (fields & PUBLISHER ? 1 : 0);
+    }
+
+    static void addTokens(const string &text, uint8_t field, map<string, uint8_t> &tokens)
     {
-        booking->returnDate = date;
-        cout << "Book returned successfully.\n";
+        for (const string &token : tokenize(text))
+            tokens[token] |= field;
+    }
 
-        Book *book = library.books[booking->bookId];
-        while (!book->reservationQueue.empty())
+    bool matchesFilters(const Book *book, const SearchQuery &query) const
+    {
+        return book->year >= query.yearFrom && book->year <= query.yearTo &&
+               (!query.filterStatus || book->status == query.status);
+    }
+
+    // Drops deleted documents once they outnumber the live ones
+    void compact()
+    {
+        vector<Book *> live;
+        for (Book *book : docs)
         {
-            string nextUserId = book->reservationQueue.front();
-            User *nextUser = nullptr;
+            if (book)
+                live.push_back(book);
+        }
+        docs.clear();
+        docOf.clear();
+        postings.clear();
+        byISBN.clear();
+        byYear.clear();
+        deleted = 0;
+        for (Book *book : live)
+            add(book);
+    }
 
-            if (library.students.count(nextUserId))
+public:
+    // Lower-cased alphanumeric words
+    static vector<string> tokenize(const string &text)
+    {
+        vector<string> tokens;
+        string token;
+        for (char c : text)
+        {
+            if (isalnum(static_cast<unsigned char>(c)))
             {
-                nextUser = library.students[nextUserId];
+                token += static_cast<char>(tolower(static_cast<unsigned char>(c)));
             }
-            else if (library.faculties.count(nextUserId))
+            else if (!token.empty())
             {
-                nextUser = library.faculties[nextUserId];
+                tokens.push_back(token);
+                token.clear();
             }
+        }
+        if (!token.empty())
+            tokens.push_back(token);
+        return tokens;
+    }
+
+    void add(Book *book)
+    {
+        if (docOf.count(book->bookId))
+            remove(book->bookId);
+
+        uint32_t doc = static_cast<uint32_t>(docs.size());
+        docs.push_back(book);
+        docOf[book->bookId] = doc;
+
+        map<string, uint8_t> tokens;
+        addTokens(book->title, TITLE, tokens);
+        addTokens(book->author, AUTHOR, tokens);
+        addTokens(book->publisher, PUBLISHER, tokens);
+        for (const auto &token : tokens)
+            postings[token.first].push_back({doc, token.second});
+
+        byISBN[book->ISBN].push_back(doc);
+        byYear.emplace(book->year, doc);
+    }
+
+    void remove(const string &bookId)
+    {
+        auto it = docOf.find(bookId);
+        if (it == docOf.end())
+            return;
+        uint32_t doc = it->second;
+        Book *book = docs[doc];
 
-            if (nextUser)
+        auto isbnIt = byISBN.find(book->ISBN);
+        if (isbnIt != byISBN.end())
+        {
+            vector<uint32_t> &copies = isbnIt->second;
+            copies.erase(find(copies.begin(), copies.end(), doc));
+            if (copies.empty())
+                byISBN.erase(isbnIt);
+        }
+        auto range = byYear.equal_range(book->year);
+        for (auto yearIt = range.first; yearIt != range.second; ++yearIt)
+        {
+            if (yearIt->second == doc)
             {
-                // Check if the next user is eligible to borrow the book
-                bool isEligible = false;
-                if (library.userTypes[nextUserId] == "student")
-                {
-                    // cout<<"i am here\n";
-                    isEligible = static_cast<Student *>(nextUser)->isEligibleToBorrow(date);
-                    cout << isEligible << endl;
-                }
-                else if (library.userTypes[nextUserId] == "faculty")
-                {
-                    isEligible = static_cast<Faculty *>(nextUser)->isEligibleToBorrow(date);
-                }
+                byYear.erase(yearIt);
+                break;
+            }
+        }
+
+        // Postings are dropped lazily: the document is simply no longer live
+        docs[doc] = nullptr;
+        docOf.erase(it);
+        if (++deleted > docs.size() / 2)
+            compact();
+    }
+
+    // Re-indexes a book whose text fields may have changed
+    void update(Book *book, const string &oldTitle, const string &oldAuthor, const string &oldPublisher,
+                const string &oldISBN, int oldYear)
+    {
+        if (book->title != oldTitle || book->author != oldAuthor || book->publisher != oldPublisher ||
+            book->ISBN != oldISBN || book->year != oldYear || !docOf.count(book->bookId))
+            add(book);
+    }
+
+    void clear()
+    {
+        docs.clear();
+        docOf.clear();
+        postings.clear();
+        byISBN.clear();
+        byYear.clear();
+        deleted = 0;
+    }
+
+    SearchResult search(const SearchQuery &query) const
+    {
+        if (query.yearFrom > query.yearTo)
+            return SearchResult(); // An empty year range; the year index cannot be walked backwards
+
+        vector<SearchHit> matches;
 
-                if (isEligible)
+        vector<string> tokens = tokenize(query.text);
+        sort(tokens.begin(), tokens.end());
+        tokens.erase(unique(tokens.begin(), tokens.end()), tokens.end());
+
+        if (!query.ISBN.empty())
+        {
+            // Exact ISBN lookup; any text must still match each candidate
+            auto it = byISBN.find(query.ISBN);
+            if (it != byISBN.end())
+            {
+                for (uint32_t doc : it->second)
                 {
-                    // Find the reservation booking in the next user's current map
-                    for (auto &bookingPair : nextUser->account.current)
+                    Book *book = docs[doc];
+                    map<string, uint8_t> bookTokens;
+                    addTokens(book->title, TITLE, bookTokens);
+                    addTokens(book->author, AUTHOR, bookTokens);
+                    addTokens(book->publisher, PUBLISHER, bookTokens);
+
+                    int score = 0;
+                    bool all = true;
+                    for (const string &token : tokens)
                     {
-                        Booking *reservationBooking = bookingPair.second;
-                        if (reservationBooking->type == BookingType::RESERVED && reservationBooking->bookId == book->bookId)
-                        {
-                            // Update the reservation booking to DIRECT_BORROW
-                            reservationBooking->type = BookingType::DIRECT_BORROW;
-                            reservationBooking->borrowDate = date;
-                            reservationBooking->returnDate = "N/A";
-                            reservationBooking->fine = 0;
-
-                            book->status = BookStatus::BORROWED;
-                            cout << "Reservation converted to borrow for user: " << nextUserId << endl;
-                            book->reservationQueue.erase(book->reservationQueue.begin());
-                            account.history[booking->bookingId] = booking;
-                            account.current.erase(it);
-                            return;
-                        }
+                        auto tokenIt = bookTokens.find(token);
+                        if (tokenIt == bookTokens.end())
+                            all = false;
+                        else
+                            score += fieldScore(tokenIt->second);
                     }
+                    if (all && matchesFilters(book, query))
+                        matches.push_back({book, score});
                 }
-                else
+            }
+        }
+        else if (!tokens.empty())
+        {
+            // Intersect posting lists, walking the shortest and probing the others
+            vector<const vector<Posting> *> lists;
+            for (const string &token : tokens)
+            {
+                auto it = postings.find(token);
+                if (it == postings.end())
+                    return SearchResult();
+                lists.push_back(&it->second);
+            }
+            sort(lists.begin(), lists.end(), [](const auto *a, const auto *b)
+                 { return a->size() < b->size(); });
+
+            vector<size_t> cursor(lists.size(), 0);
+            for (const Posting &posting : *lists[0])
+            {
+                Book *book = docs[posting.doc];
+                if (!book)
+                    continue;
+
+                int score = fieldScore(posting.fields);
+                bool all = true;
+                for (size_t i = 1; i < lists.size() && all; i++)
                 {
-                    // Remove ineligible user from the reservation queue and their current map
-                    book->reservationQueue.erase(book->reservationQueue.begin());
-                    for (auto &bookingPair : nextUser->account.current)
-                    {
-                        Booking *reservationBooking = bookingPair.second;
-                        if (reservationBooking->type == BookingType::RESERVED && reservationBooking->bookId == book->bookId)
-                        {
-                            nextUser->account.current.erase(bookingPair.first);
-                            break;
-                        }
-                    }
-                    cout << "User " << nextUserId << " is ineligible. Removed from the reservation queue.\n";
+                    const vector<Posting> &list = *lists[i];
+                    auto it = lower_bound(list.begin() + cursor[i], list.end(), posting.doc,
+                                          [](const Posting &p, uint32_t doc)
+                                          { return p.doc < doc; });
+                    cursor[i] = it - list.begin();
+                    if (it == list.end() || it->doc != posting.doc)
+                        all = false;
+                    else
+                        score += fieldScore(it->fields);
                 }
+                if (all && matchesFilters(book, query))
+                    matches.push_back({book, score});
             }
-            else
+        }
+        else
+        {
+            // Filters only: walk the year index over the requested range
+            auto first = query.yearFrom == INT_MIN ? byYear.begin() : byYear.lower_bound(query.yearFrom);
+            auto last = query.yearTo == INT_MAX ? byYear.end() : byYear.upper_bound(query.yearTo);
+            for (auto it = first; it != last; ++it)
             {
-                // Remove invalid user from the reservation queue
-                book->reservationQueue.erase(book->reservationQueue.begin());
-                cout << "User " << nextUserId << " not found. Removed from the reservation queue.\n";
+                Book *book = docs[it->second];
+                if (book && matchesFilters(book, query))
+                    matches.push_back({book, 0});
             }
         }
 
-        // If no eligible user is found, mark the book as available
-        book->status = BookStatus::AVAILABLE;
-        cout << "No eligible reservations left. Book is now available.\n";
+        SearchResult result;
+        result.total = matches.size();
+        size_t begin = min(query.page * query.pageSize, matches.size());
+        size_t end = query.pageSize > matches.size() - begin ? matches.size() : begin + query.pageSize;
+
+        // Only the requested page needs to be fully ordered
+        auto better = [](const SearchHit &a, const SearchHit &b)
+        {
+            if (a.score != b.score)
+                return a.score > b.score;
+            return a.book->bookId < b.book->bookId;
+        };
+        partial_sort(matches.begin(), matches.begin() + end, matches.end(), better);
+        result.hits.assign(matches.begin() + begin, matches.begin() + end);
+        return result;
     }
+};
 
-    account.history[booking->bookingId] = booking;
-    account.current.erase(it);
+// Global catalog search index
+CatalogSearch catalogSearch;
+
+// Takes a book out of the catalog. Its record stays behind as a tombstone so the
+// bookings that refer to it still show its details.
+void retireBook(Book *book)
+{
+    library.books.erase(book->bookId);
+    catalogSearch.remove(book->bookId);
+    book->status = BookStatus::DELETED;
+    book->reservationQueue.clear();
+    library.deletedBooks[book->bookId] = book;
 }
 
-void Faculty::login()
+// Frees the tombstones no booking refers to any more; run when the journal is compacted
+void purgeTombstones()
 {
-    cout << "Faculty logged in successfully. Welcome, " << name << "!\n";
-    string date;
-    cout << "Enter today's date (DDMMYYYY): ";
-    cin >> date;
-    while (true)
+    if (library.deletedBooks.empty())
+        return;
+    unordered_set<Book *> referenced;
+    auto collect = [&](const Account &account) {
+        for (const auto &entry : account.current)
+            referenced.insert(entry.second->book);
+        for (const auto &entry : account.history)
+            referenced.insert(entry.second->book);
+    };
+    for (const auto &entry : library.users)
+        collect(entry.second.user->account);
+
+    for (auto it = library.deletedBooks.begin(); it != library.deletedBooks.end();)
     {
-        cout << "\nWhat would you like to do?\n";
-        cout << "1. Borrow Book\n";
-        cout << "2. Return Book\n";
-        cout << "3. View Booking History\n";
-        cout << "4. View Current Booking Status\n";
-        cout << "5. List Books in Library\n";
-        cout << "6. Log Out\n";
-        cout << "Enter your choice: ";
+        if (referenced.count(it->second))
+        {
+            ++it;
+            continue;
+        }
+        historyStore.forget(it->second);
+        bookPool.destroy(it->second);
+        it = library.deletedBooks.erase(it);
+    }
+}
 
-        int choice;
-        cin >> choice;
+// A catalog book or the tombstone of a deleted one, or nullptr
+Book *findBookRecord(const string &bookId)
+{
+    if (Book *book = library.books.find(bookId))
+        return book;
+    auto it = library.deletedBooks.find(bookId);
+    return it == library.deletedBooks.end() ? nullptr : it->second;
+}
 
-        switch (choice)
-        {
-        case 1:
-        {
+// How listings are displayed: page size, starting record, layout and destination
+struct ReportOptions
+{
+    size_t pageSize = 20;
+    size_t offset = 0;        // Records to skip before the first page
+    bool table = false;       // One line per record instead of one line per field
+    bool interactive = true;  // Ask before each further page; otherwise show a single page
+    ostream *out = &cout;
+};
 
-            borrowBook(date);
-            break;
-        }
-        case 2:
+// Global listing options, set from the command line (--page-size N, --table)
+ReportOptions reportOptions;
+
+// Formats listing records into a buffer that is written out once per page
+class ReportRenderer
+{
+    ReportOptions options;
+    size_t total;
+    string buffer;
+    string row;
+    string header;
+    size_t index = 0;  // Records offered so far
+    size_t onPage = 0; // Records on the current page
+    size_t shown = 0;
+    bool stopped = false;
+
+    void cell(const char *label)
+    {
+        if (!row.empty())
+            row += " | ";
+        if (shown == 0)
         {
-            returnBook(date);
-            break;
-        }
-        case 3:
-            showHistory();
-            break;
-        case 4:
-            current_booking(date);
-            break;
-        case 5:
-            list_books();
-            break;
-        case 6:
-            cout << "Logging out...\n";
-            return;
-        default:
-            cout << "Invalid choice. Please try again.\n";
+            if (!header.empty())
+                header += " | ";
+            header += label;
         }
     }
-}
 
-// Librarian class functions
-Librarian::Librarian(string name, string ID, string password) : User(name, ID, password) {}
+public:
+    static constexpr const char *separator = "----------------------------------------\n";
 
-void Librarian::addNewUser()
-{
-    cout << "Select the user type\n1. Student\n2. Faculty\n";
-    int type;
-    cin >> type;
+    ReportRenderer(const ReportOptions &options, size_t total) : options(options), total(total) {}
+    ~ReportRenderer() { finish(); }
+
+    bool tableMode() const { return options.table; }
+
+    // True once the reader declined another page or the single page is full
+    bool done() const { return stopped; }
+
+    void text(string_view line)
+    {
+        buffer.append(line);
+        buffer += '\n';
+    }
+
+    // Starts a record; false means skip it (it is before the offset, or the listing is done)
+    bool beginRecord()
+    {
+        if (stopped || index++ < options.offset)
+            return false;
+        if (onPage == options.pageSize)
+        {
+            flush();
+            if (!options.interactive)
+            {
+                stopped = true;
+                return false;
+            }
+            *options.out << "Show the next page? (yes/no): " << std::flush;
+            string choice;
+            if (!(cin >> choice) || choice != "yes")
+            {
+                stopped = true;
+                return false;
+            }
+            onPage = 0;
+        }
+        onPage++;
+        return true;
+    }
+
+    void field(const char *label, string_view value)
+    {
+        if (options.table)
+        {
+            cell(label);
+            row.append(value);
+        }
+        else
+        {
+            buffer += label;
+            buffer += ": ";
+            buffer.append(value);
+            buffer += '\n';
+        }
+    }
+
+    void field(const char *label, long long value)
+    {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        field(label, string_view(digits, result.ptr - digits));
+    }
+
+    void field(const char *label, Date value) { field(label, string_view(value.toString())); }
+
+    // Ends a record; a table record written as one text() line instead of fields is only counted
+    void endRecord()
+    {
+        if (options.table)
+        {
+            if (!row.empty())
+            {
+                if (shown == 0)
+                {
+                    buffer += header;
+                    buffer += '\n';
+                    buffer += separator;
+                }
+                buffer += row;
+                buffer += '\n';
+                row.clear();
+            }
+        }
+        else
+        {
+            buffer += separator;
+        }
+        shown++;
+    }
+
+    void flush()
+    {
+        options.out->write(buffer.data(), buffer.size());
+        options.out->flush();
+        buffer.clear();
+    }
+
+    // Notes a partial listing and writes out whatever is buffered
+    void finish()
+    {
+        if (shown > 0 && shown < total)
+        {
+            size_t first = min(options.offset, total) + 1;
+            buffer += "Showing records " + to_string(first) + "-" + to_string(first + shown - 1) + " of " +
+                      to_string(total) + "\n";
+            shown = total; // Only noted once
+        }
+        if (!buffer.empty())
+            flush();
+    }
+};
+
+// Function definitions
+string generateUniqueId(IdKind kind)
+{
+    return idAllocator.allocate(kind);
+}
+
+int daysBetweenDates(Date date1, Date date2)
+{
+    return abs(date2 - date1);
+}
+
+int calculateFine(Date borrowDate, Date returnDate)
+{
+    if (!borrowDate.isSet() || !returnDate.isSet())
+        return 0; // Nothing is borrowed yet (a reservation)
+
+    int days = returnDate - borrowDate;
+    int fine = 0;
+
+    if (days > 15)
+    {
+        fine = (days - 15) * 10; // Fine of 10 rupees per day for each day beyond 15
+    }
+
+    return fine;
+}
+
+// Reads today's date from the terminal, asking again until it is a valid date
+Date readTodaysDate()
+{
+    string text;
+    while (true)
+    {
+        cout << "Enter today's date (DDMMYYYY): ";
+        if (!(cin >> text))
+            return Date();
+
+        Date date;
+        if (text != "N/A" && Date::parse(text, date))
+            return date;
+        cout << "Invalid date format. Use ddmmyyyy.\n";
+    }
+}
+
+// Book class functions
+Book::Book(string bookId, string title, string author, string publisher, string ISBN, int year)
+{
+    this->bookId = bookId;
+    this->title = title;
+    this->author = author;
+    this->publisher = publisher;
+    this->ISBN = ISBN;
+    this->year = year;
+    this->status = BookStatus::AVAILABLE;
+    this->reservationQueue = ReservationQueue();
+}
+
+// Booking class functions
+Booking::Booking(string bookingId, Book *book, User *user, Date bookingDate, Date borrowDate, Date returnDate,
+                 int fine, BookingType type)
+{
+    this->bookingId = bookingId;
+    this->book = book;
+    this->user = user;
+    this->bookingDate = bookingDate;
+    this->borrowDate = borrowDate;
+    this->returnDate = returnDate;
+    this->fine = fine;
+    this->type = type;
+}
+
+// Password hashing. Credentials are stored as pbkdf2-sha256$<iterations>$<salt>$<hash>,
+// with a random 16-byte salt and the salt and hash in hex. A credential without that
+// prefix is a plaintext password from an older library_data.csv; it still logs in and
+// is replaced by a hash the first time it does.
+const unsigned passwordIterations = 10000;
+const char passwordScheme[] = "pbkdf2-sha256$";
+
+// SHA-256 (FIPS 180-4)
+class Sha256
+{
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    unsigned char buffer[64];
+    size_t buffered = 0;
+    uint64_t length = 0;
+
+    static uint32_t rotate(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const unsigned char *block)
+    {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+            w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 | uint32_t(block[4 * i + 2]) << 8 |
+                   block[4 * i + 3];
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+public:
+    static constexpr size_t digestSize = 32;
+
+    Sha256 &update(const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        length += size;
+        while (size > 0)
+        {
+            if (buffered == 0 && size >= 64)
+            {
+                compress(bytes);
+                bytes += 64;
+                size -= 64;
+                continue;
+            }
+            size_t taken = min(size, 64 - buffered);
+            memcpy(buffer + buffered, bytes, taken);
+            buffered += taken;
+            bytes += taken;
+            size -= taken;
+            if (buffered == 64)
+            {
+                compress(buffer);
+                buffered = 0;
+            }
+        }
+        return *this;
+    }
+
+    // Finishes a hash of exactly one 64-byte block (an HMAC pad) followed by `message`,
+    // one digest long, without changing this state. The padded final block is built
+    // directly instead of going through update().
+    void finishPadded(const unsigned char message[digestSize], unsigned char digest[digestSize]) const
+    {
+        unsigned char block[64] = {};
+        memcpy(block, message, digestSize);
+        block[digestSize] = 0x80;
+        block[62] = (64 + digestSize) * 8 >> 8; // The length in bits, big-endian
+        block[63] = static_cast<unsigned char>((64 + digestSize) * 8);
+        Sha256 hash = *this;
+        hash.compress(block);
+        hash.writeDigest(digest);
+    }
+
+    void finish(unsigned char digest[digestSize])
+    {
+        uint64_t bits = length * 8;
+        unsigned char padding[72] = {0x80};
+        size_t padSize = (buffered < 56 ? 56 : 120) - buffered;
+        for (int i = 0; i < 8; i++)
+            padding[padSize + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        update(padding, padSize + 8);
+        writeDigest(digest);
+    }
+
+private:
+    void writeDigest(unsigned char digest[digestSize]) const
+    {
+        for (int i = 0; i < 8; i++)
+            for (int j = 0; j < 4; j++)
+                digest[4 * i + j] = static_cast<unsigned char>(state[i] >> (24 - 8 * j));
+    }
+};
+
+// PBKDF2-HMAC-SHA256 (RFC 8018) for a single 32-byte block. The HMAC key is the same in
+// every round, so the hash states after the inner and outer pads are computed once and
+// each round costs two compressions.
+void pbkdf2(const string &password, const unsigned char *salt, size_t saltSize, unsigned iterations,
+            unsigned char out[Sha256::digestSize])
+{
+    unsigned char key[64] = {};
+    if (password.size() > sizeof(key))
+        Sha256().update(password.data(), password.size()).finish(key);
+    else
+        memcpy(key, password.data(), password.size());
+
+    unsigned char pad[64];
+    Sha256 inner, outer;
+    for (size_t i = 0; i < sizeof(pad); i++)
+        pad[i] = key[i] ^ 0x36;
+    inner.update(pad, sizeof(pad));
+    for (size_t i = 0; i < sizeof(pad); i++)
+        pad[i] = key[i] ^ 0x5c;
+    outer.update(pad, sizeof(pad));
+
+    const unsigned char blockIndex[4] = {0, 0, 0, 1};
+    unsigned char u[Sha256::digestSize];
+    Sha256 hash = inner;
+    hash.update(salt, saltSize).update(blockIndex, sizeof(blockIndex)).finish(u);
+    hash = outer;
+    hash.update(u, sizeof(u)).finish(u);
+    memcpy(out, u, sizeof(u));
+    for (unsigned round = 1; round < iterations; round++)
+    {
+        inner.finishPadded(u, u);
+        outer.finishPadded(u, u);
+        for (size_t i = 0; i < sizeof(u); i++)
+            out[i] ^= u[i];
+    }
+}
+
+string toHex(const unsigned char *bytes, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    string text;
+    for (size_t i = 0; i < size; i++)
+    {
+        text += digits[bytes[i] >> 4];
+        text += digits[bytes[i] & 15];
+    }
+    return text;
+}
+
+bool fromHex(string_view text, vector<unsigned char> &bytes)
+{
+    auto nibble = [](char c)
+    { return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1; };
+    if (text.size() % 2 != 0)
+        return false;
+    bytes.clear();
+    for (size_t i = 0; i < text.size(); i += 2)
+    {
+        int high = nibble(text[i]), low = nibble(text[i + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        bytes.push_back(static_cast<unsigned char>(high << 4 | low));
+    }
+    return true;
+}
+
+// Compares without stopping at the first difference, so the time taken does not tell
+// an attacker how much of a guess was right
+bool constantTimeEquals(string_view a, string_view b)
+{
+    unsigned char difference = a.size() != b.size();
+    for (size_t i = 0; i < min(a.size(), b.size()); i++)
+        difference |= a[i] ^ b[i];
+    return difference == 0;
+}
+
+bool isPasswordHash(string_view credential)
+{
+    return credential.substr(0, sizeof(passwordScheme) - 1) == passwordScheme;
+}
+
+// A new credential for `password` with a fresh random salt
+string hashPassword(const string &password, unsigned iterations = passwordIterations)
+{
+    static mutex entropyLock;
+    static random_device entropy;
+    unsigned char salt[16];
+    {
+        lock_guard<mutex> guard(entropyLock);
+        for (size_t i = 0; i < sizeof(salt); i += 4)
+        {
+            uint32_t word = entropy();
+            memcpy(salt + i, &word, 4);
+        }
+    }
+    unsigned char hash[Sha256::digestSize];
+    pbkdf2(password, salt, sizeof(salt), iterations, hash);
+    return passwordScheme + to_string(iterations) + "$" + toHex(salt, sizeof(salt)) + "$" +
+           toHex(hash, sizeof(hash));
+}
+
+bool verifyPassword(const string &password, const string &credential)
+{
+    if (!isPasswordHash(credential))
+        return constantTimeEquals(password, credential); // A legacy plaintext password
+
+    string_view rest = string_view(credential).substr(sizeof(passwordScheme) - 1);
+    size_t first = rest.find('$');
+    size_t second = first == string_view::npos ? first : rest.find('$', first + 1);
+    if (second == string_view::npos)
+        return false;
+    string_view iterationText = rest.substr(0, first), saltText = rest.substr(first + 1, second - first - 1);
+    string_view hashText = rest.substr(second + 1);
+    unsigned iterations = 0;
+    vector<unsigned char> salt, expected;
+    auto [end, error] = from_chars(iterationText.data(), iterationText.data() + iterationText.size(), iterations);
+    if (error != errc() || end != iterationText.data() + iterationText.size() || iterations == 0 ||
+        !fromHex(saltText, salt) || !fromHex(hashText, expected) || expected.size() != Sha256::digestSize)
+        return false;
+
+    unsigned char hash[Sha256::digestSize];
+    pbkdf2(password, salt.data(), salt.size(), iterations, hash);
+    return constantTimeEquals(string_view(reinterpret_cast<const char *>(hash), sizeof(hash)),
+                              string_view(reinterpret_cast<const char *>(expected.data()), expected.size()));
+}
+
+// Library operations. They apply the business rules and write the journal but do no
+// terminal I/O, so the menus and batch mode (--batch) share them.
+struct OpResult
+{
+    bool ok = false;
+    string message;       // Why the operation failed, or what it did
+    string id;            // Booking, user or book the operation created or closed
+    int fine = 0;         // Fine charged on a return
+    vector<string> notes; // Reservation hand-offs triggered by a return
+};
+
+OpResult failed(const string &message)
+{
+    OpResult result;
+    result.message = message;
+    return result;
+}
+
+User *findUser(const string &userId)
+{
+    const UserEntry *entry = library.findEntry(userId);
+    return entry ? entry->user : nullptr;
+}
+
+OpResult checkoutBook(User *user, const string &bookId, Date date)
+{
+    string reason = user->ineligibilityReason(date);
+    if (!reason.empty())
+        return failed(reason);
+    Book *book = library.books.find(bookId);
+    if (!book)
+        return failed("Book not found.");
+    if (book->status != BookStatus::AVAILABLE)
+        return failed("The book is currently borrowed.");
+
+    OpResult result;
+    result.id = generateUniqueId(IdKind::BOOKING);
+    Booking *newBooking = bookingPool.create(result.id, book, user, date, date, Date(), 0, BookingType::DIRECT_BORROW);
+
+    user->account.addCurrent(newBooking);
+    book->status = BookStatus::BORROWED;
+    journal.record(JournalOp::CURRENT_BOOKING, bookingRow(newBooking));
+    journal.record(JournalOp::BOOK, bookRow(book));
+    commitJournal();
+
+    result.ok = true;
+    result.message = "Book borrowed successfully! Booking ID: " + result.id;
+    return result;
+}
+
+OpResult reserveBook(User *user, const string &bookId, Date date)
+{
+    string reason = user->ineligibilityReason(date);
+    if (!reason.empty())
+        return failed(reason);
+    Book *book = library.books.find(bookId);
+    if (!book)
+        return failed("Book not found.");
+    if (book->status == BookStatus::AVAILABLE)
+        return failed("The book is available; borrow it instead.");
+    if (user->account.findCurrent(bookId, BookingType::RESERVED))
+        return failed("You have already reserved this book.");
+
+    OpResult result;
+    book->reservationQueue.push(user->UniqueId);
+    result.id = generateUniqueId(IdKind::BOOKING);
+    Booking *newBooking = bookingPool.create(result.id, book, user, date, Date(), Date(), 0, BookingType::RESERVED);
+
+    user->account.addCurrent(newBooking);
+    journal.record(JournalOp::CURRENT_BOOKING, bookingRow(newBooking));
+    journal.record(JournalOp::BOOK, bookRow(book));
+    commitJournal();
+
+    result.ok = true;
+    result.message = "Book reserved successfully! Booking ID: " + result.id;
+    return result;
+}
+
+// A borrowed book handed back: `userId` returns `bookId` on `date`
+struct ReturnEvent
+{
+    string userId;
+    string bookId;
+    Date date;
+};
+
+// Reservation hand-offs. Returning a borrowed book raises a "book returned" event, and the
+// engine assigns the book to the first eligible user in its queue, dropping the ineligible
+// users ahead of them; the book becomes available when nobody is left. Eligibility comes
+// from User::mayBorrow(), which is cached per user and date.
+class ReservationEngine
+{
+    atomic<size_t> assigned{0}, dropped{0}, released{0};
+    atomic<size_t> checks{0}, cachedChecks{0};
+
+public:
+    // Handles one event inside the caller's transaction. Returns the reservation that now
+    // holds the book, or nullptr if it became available; each queue change is journaled
+    // and described in `notes`.
+    Booking *returned(Book *book, Date date, vector<string> &notes)
+    {
+        while (!book->reservationQueue.empty())
+        {
+            string nextUserId = book->reservationQueue.front();
+            book->reservationQueue.pop();
+
+            User *nextUser = findUser(nextUserId);
+            if (!nextUser)
+            {
+                dropped++;
+                notes.push_back("User " + nextUserId + " not found. Removed from the reservation queue.");
+                continue;
+            }
+
+            // Find the reservation booking in the next user's current map
+            Booking *reservation = nextUser->account.findCurrent(book->bookId, BookingType::RESERVED);
+            if (reservation)
+            {
+                checks++;
+                if (nextUser->eligibilityCached(date))
+                    cachedChecks++;
+                if (nextUser->mayBorrow(date))
+                {
+                    nextUser->takeReservation(reservation, date);
+                    book->status = BookStatus::BORROWED;
+                    journal.record(JournalOp::CURRENT_BOOKING, bookingRow(reservation));
+                    journal.record(JournalOp::BOOK, bookRow(book));
+                    assigned++;
+                    notes.push_back("Reservation converted to borrow for user: " + nextUserId);
+                    return reservation;
+                }
+
+                // Remove the ineligible user's reservation as well
+                journal.record(JournalOp::DROP_BOOKING, nextUserId + "," + reservation->bookingId);
+                bookingPool.destroy(nextUser->account.removeCurrent(reservation->bookingId));
+            }
+            dropped++;
+            notes.push_back("User " + nextUserId + " is ineligible. Removed from the reservation queue.");
+        }
+
+        book->status = BookStatus::AVAILABLE;
+        journal.record(JournalOp::BOOK, bookRow(book));
+        released++;
+        notes.push_back("No eligible reservations left. Book is now available.");
+        return nullptr;
+    }
+
+    vector<OpResult> processReturns(const vector<ReturnEvent> &events, size_t &groupCount);
+
+    size_t assignments() const { return assigned; }
+    size_t drops() const { return dropped; }
+    size_t releases() const { return released; }
+    size_t eligibilityChecks() const { return checks; }
+    size_t cachedEligibilityChecks() const { return cachedChecks; }
+};
+
+// Global reservation engine
+ReservationEngine reservations;
+
+// Closes one of the user's current bookings without committing: a borrowed book is
+// returned (charging any fine) and handed to the reservation queue; a reservation is
+// cancelled
+OpResult closeBooking(User *user, map<string, Booking *>::iterator it, Date date)
+{
+    OpResult result;
+    Booking *booking = it->second;
+    Book *book = booking->book->status == BookStatus::DELETED ? nullptr : booking->book;
+    result.id = booking->bookingId;
+
+    if (booking->type == BookingType::RESERVED)
+    {
+        booking->fine = 0;
+        result.ok = book && book->reservationQueue.erase(user->UniqueId);
+        if (result.ok)
+            journal.record(JournalOp::BOOK, bookRow(book));
+        result.message = result.ok ? "Reservation cancelled successfully." : "Reservation not found. Return failed.";
+    }
+    else
+    {
+        booking->returnDate = date;
+        booking->fine = calculateFine(booking->borrowDate, date);
+        result.fine = user->paysFines() ? booking->fine : 0;
+        result.ok = true;
+        result.message = "Book returned successfully.";
+        if (book)
+            reservations.returned(book, date, result.notes);
+    }
+
+    user->account.moveToHistory(it);
+    journal.record(JournalOp::HISTORY_BOOKING, bookingRow(booking));
+    return result;
+}
+
+// Closes one of the user's current bookings and commits the change
+OpResult returnBooking(User *user, map<string, Booking *>::iterator it, Date date)
+{
+    OpResult result = closeBooking(user, it, date);
+    commitJournal();
+    return result;
+}
+
+// Returns the book of one event, as the batch `return` command does
+OpResult returnEvent(const ReturnEvent &event)
+{
+    User *user = findUser(event.userId);
+    if (!user)
+        return failed("User with ID " + event.userId + " not found.");
+    Booking *booking = user->account.findCurrent(event.bookId, BookingType::DIRECT_BORROW);
+    if (!booking)
+        return failed("User " + event.userId + " has not borrowed book " + event.bookId + ".");
+    return closeBooking(user, user->account.current.find(booking->bookingId), event.date);
+}
+
+// Runs many returns in one pass, such as a drop-box emptied at the end of term, and gives
+// their results in event order. An event can touch its book, the borrower and the users
+// its hand-off visits in the book's queue, so events are grouped with union-find over those
+// books and users: groups share nothing and run in parallel, while the events of a group
+// run in the order given. Each book therefore sees its returns in order and the outcome is
+// the same as returning the books one by one. The groups are packed into one bin per core,
+// largest first, and each bin is committed as one transaction so the bins share journal
+// syncs.
+//
+// A hand-off stops at the first eligible user, so k returns of a book visit its queue up to
+// the k-th user who may borrow. During a pass users only lose bookings or have reservations
+// converted, and when the dates span no more than a student's loan period no converted
+// borrow can become overdue within the pass; nobody who may borrow now can lose that, and
+// only that prefix of each queue is grouped. Otherwise the whole queue is.
+vector<OpResult> ReservationEngine::processReturns(const vector<ReturnEvent> &events, size_t &groupCount)
+{
+    unordered_map<string, size_t> returnsOf;
+    Date first, last;
+    for (const ReturnEvent &event : events)
+    {
+        returnsOf[event.bookId]++;
+        if (!first.isSet() || event.date < first)
+            first = event.date;
+        if (!last.isSet() || last < event.date)
+            last = event.date;
+    }
+    bool prefixOnly = !events.empty() && last - first <= 15;
+
+    vector<size_t> parent;
+    unordered_map<string, size_t> bookNodes, userNodes;
+    auto rootOf = [&](size_t node)
+    {
+        while (parent[node] != node)
+            node = parent[node] = parent[parent[node]];
+        return node;
+    };
+    auto nodeOf = [&](unordered_map<string, size_t> &nodes, const string &id)
+    {
+        auto inserted = nodes.emplace(id, parent.size());
+        if (inserted.second)
+            parent.push_back(parent.size());
+        return inserted.first->second;
+    };
+    auto unite = [&](size_t a, size_t b)
+    {
+        parent[rootOf(a)] = rootOf(b);
+    };
+
+    vector<size_t> bookOf(events.size());
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        size_t nodeCount = parent.size();
+        size_t bookNode = nodeOf(bookNodes, events[i].bookId);
+        bookOf[i] = bookNode;
+        Book *book = bookNode == nodeCount ? library.books.find(events[i].bookId) : nullptr;
+        if (book) // First event for the book: join everyone its hand-offs can visit
+        {
+            size_t eligibleLeft = prefixOnly ? returnsOf[events[i].bookId] : SIZE_MAX;
+            for (auto it = book->reservationQueue.begin(); it != book->reservationQueue.end() && eligibleLeft > 0; ++it)
+            {
+                unite(nodeOf(userNodes, *it), bookNode);
+                User *user = prefixOnly ? findUser(*it) : nullptr;
+                if (user && user->account.findCurrent(book->bookId, BookingType::RESERVED) && user->mayBorrow(last))
+                    eligibleLeft--;
+            }
+        }
+        unite(nodeOf(userNodes, events[i].userId), bookNode);
+    }
+
+    unordered_map<size_t, size_t> groupOf;
+    vector<vector<size_t>> groups;
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        auto inserted = groupOf.emplace(rootOf(bookOf[i]), groups.size());
+        if (inserted.second)
+            groups.emplace_back();
+        groups[inserted.first->second].push_back(i);
+    }
+    groupCount = groups.size();
+
+    vector<size_t> order(groups.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](size_t a, size_t b)
+         { return groups[a].size() > groups[b].size(); });
+    size_t binCount = min<size_t>(max(1u, thread::hardware_concurrency()), groups.size());
+    vector<vector<size_t>> bins(binCount);
+    vector<size_t> binLoad(binCount, 0);
+    for (size_t group : order)
+    {
+        size_t bin = min_element(binLoad.begin(), binLoad.end()) - binLoad.begin();
+        bins[bin].push_back(group);
+        binLoad[bin] += groups[group].size();
+    }
+
+    vector<OpResult> results(events.size());
+    parallelFor(binCount, [&](size_t bin)
+                {
+                    for (size_t group : bins[bin])
+                        for (size_t i : groups[group])
+                            results[i] = returnEvent(events[i]);
+                    journal.commit(); });
+    if (compactOnCommit && journal.needsCompaction())
+        compactJournal();
+    return results;
+}
+
+OpResult withdrawReservation(User *user, const string &bookId)
+{
+    Book *book = library.books.find(bookId);
+    if (!book)
+        return failed("Book not found.");
+    if (!book->reservationQueue.erase(user->UniqueId))
+        return failed("No reservation found for book ID: " + bookId);
+
+    OpResult result;
+    journal.record(JournalOp::BOOK, bookRow(book));
+    Booking *reservation = user->account.findCurrent(bookId, BookingType::RESERVED);
+    if (reservation)
+    {
+        result.id = reservation->bookingId;
+        journal.record(JournalOp::DROP_BOOKING, user->UniqueId + "," + reservation->bookingId);
+        bookingPool.destroy(user->account.removeCurrent(reservation->bookingId));
+    }
+    commitJournal();
+
+    result.ok = true;
+    result.message = "Reservation cancelled successfully for book ID: " + bookId;
+    return result;
+}
+
+// Adds a student or faculty member; `role` is "student" or "faculty"
+OpResult registerUser(const string &role, const string &name, const string &password)
+{
+    Role parsed;
+    if (!parseRole(role, parsed) || parsed == Role::LIBRARIAN)
+        return failed("Invalid user type. Use 'student' or 'faculty'.");
+
+    OpResult result;
+    string uniqueId = generateUniqueId(parsed == Role::FACULTY ? IdKind::FACULTY : IdKind::STUDENT);
+    User *user = createUser(parsed, name, uniqueId, hashPassword(password));
+    journal.record(JournalOp::USER, userRow(user, role));
+    commitJournal();
+
+    result.ok = true;
+    result.id = uniqueId;
+    result.message = "New " + role + " added. His Unique Id is " + uniqueId;
+    return result;
+}
+
+// Checks a user's password. A legacy plaintext password that matches is replaced by a
+// hash, so each one is upgraded at its user's next login.
+bool checkLogin(const UserEntry *entry, const string &password)
+{
+    if (!entry || !entry->user->authenticate(password))
+        return false;
+    User *user = entry->user;
+    if (!isPasswordHash(user->getCredential()))
+    {
+        user->setCredential(hashPassword(password));
+        journal.record(JournalOp::USER, userRow(user, roleName(entry->role)));
+        commitJournal();
+    }
+    return true;
+}
+
+OpResult registerBook(const string &title, const string &author, const string &publisher, const string &ISBN, int year)
+{
+    OpResult result;
+    string bookId = generateUniqueId(IdKind::BOOK);
+    Book *book = bookPool.create(bookId, title, author, publisher, ISBN, year);
+    library.books.insert(book);
+    catalogSearch.add(book);
+    journal.record(JournalOp::BOOK, bookRow(book));
+    commitJournal();
+
+    result.ok = true;
+    result.id = bookId;
+    result.message = "Book added successfully. ID: " + bookId;
+    return result;
+}
+
+OpResult removeUser(const string &userId)
+{
+    const UserEntry *entry = library.findEntry(userId);
+    if (!entry)
+        return failed("User with ID " + userId + " not found.");
+    if (entry->role == Role::LIBRARIAN)
+        return failed("Librarians cannot be deleted.");
+
+    string role = entry->role == Role::FACULTY ? "Faculty" : "Student";
+    if (!entry->user->account.current.empty())
+        return failed("Cannot delete " + string(roleName(entry->role)) + ". They have active bookings.");
+
+    destroyUser(userId);
+    journal.record(JournalOp::DELETE_USER, userId);
+    commitJournal();
+
+    OpResult result;
+    result.ok = true;
+    result.id = userId;
+    result.message = role + " with ID " + userId + " deleted successfully.";
+    return result;
+}
+
+OpResult removeBook(const string &bookId)
+{
+    Book *book = library.books.find(bookId);
+    if (!book)
+        return failed("Book with ID " + bookId + " not found.");
+    if (book->status != BookStatus::AVAILABLE || !book->reservationQueue.empty())
+        return failed("Cannot delete book. It is either borrowed or has reservations.");
+
+    retireBook(book);
+    journal.record(JournalOp::DELETE_BOOK, bookId);
+    commitJournal();
+
+    OpResult result;
+    result.ok = true;
+    result.id = bookId;
+    result.message = "Book with ID " + bookId + " deleted successfully.";
+    return result;
+}
+
+// User class functions
+User::User(string name, string ID, string credential)
+{
+    this->name = name;
+    this->UniqueId = ID;
+    this->credential = credential;
+    this->account = Account();
+}
+
+bool User::isEligibleToBorrow(Date date)
+{
+    string reason = ineligibilityReason(date);
+    if (!reason.empty())
+        cout << reason << "\n";
+    return reason.empty();
+}
+
+// Whether the user may borrow on `date`, without the reason. The answer is cached until
+// the account changes, so a user queued for many books returned on the same day is
+// checked once.
+bool User::mayBorrow(Date date)
+{
+    if (!eligibilityCached(date))
+    {
+        eligible = ineligibilityReason(date).empty();
+        eligibleOn = date;
+        eligibleRevision = account.revision();
+    }
+    return eligible;
+}
+
+bool User::eligibilityCached(Date date) const
+{
+    return eligibleOn.isSet() && eligibleOn == date && eligibleRevision == account.revision();
+}
+
+// Turns the user's reservation into a borrow from `date`. A cached answer for `date` stays
+// valid: the user holds as many bookings as before and the new borrow is not yet overdue.
+void User::takeReservation(Booking *reservation, Date date)
+{
+    bool cached = eligibilityCached(date);
+    account.convertReservation(reservation, date);
+    if (cached)
+        eligibleRevision = account.revision();
+}
+
+void User::borrowBook(Date date)
+{
+    if (isEligibleToBorrow(date) == false)
+        return;
+    cout << "Enter the book ID that you want to borrow: ";
+    string bookId;
+    cin >> bookId;
+
+    Book *book = library.books.find(bookId);
+    if (!book)
+    {
+        cout << "Book not found." << endl;
+        return;
+    }
+
+    OpResult result;
+    if (book->status == BookStatus::AVAILABLE)
+    {
+        cout << "The book is available. Do you want to borrow it? (yes/no): ";
+        string choice;
+        cin >> choice;
+        if (choice != "yes")
+        {
+            cout << "Borrowing cancelled." << endl;
+            return;
+        }
+        result = checkoutBook(this, bookId, date);
+    }
+    else
+    {
+        cout << "The book is currently borrowed. Do you want to reserve it? (yes/no): ";
+        string choice;
+        cin >> choice;
+        if (choice != "yes")
+        {
+            cout << "Reservation cancelled." << endl;
+            return;
+        }
+        result = reserveBook(this, bookId, date);
+    }
+    cout << result.message << endl;
+}
+
+void User::returnBook(Date date)
+{
+    if (account.current.empty())
+    {
+        cout << "There is nothing to return.\n";
+        return;
+    }
+
+    int num = 0;
+    cout << "Books available for return:\n";
+    cout << "--------------------------------------------------------------------------------------------------------\n";
+    cout << "No. | Booking ID | Book Title          | Fine | Type\n";
+    cout << "--------------------------------------------------------------------------------------------------------\n";
+    for (auto &i : account.current)
+    {
+        Booking *booking = i.second;
+        booking->fine = calculateFine(booking->borrowDate, date);
+        cout << num << " | "
+             << booking->bookingId << " | "
+             << booking->book->title << " | "
+             << booking->fine << " | "
+             << (booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow") << endl;
+        num++;
+    }
+    cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    cout << "Enter the number of the book you want to return: ";
+    int choice;
+    cin >> choice;
+
+    if (choice < 0 || choice >= account.current.size())
+    {
+        cout << "Invalid choice. Return failed.\n";
+        return;
+    }
+
+    auto it = account.current.begin();
+    advance(it, choice);
+    Booking *booking = it->second;
+
+    // The fine has to be paid before the book is taken back
+    if (booking->type == BookingType::DIRECT_BORROW && paysFines() && booking->fine > 0)
+    {
+        cout << "You have a fine of " << booking->fine << " rupees. Do you want to pay it? (yes/no): ";
+        string payChoice;
+        cin >> payChoice;
+
+        if (payChoice != "yes")
+        {
+            cout << "Return failed. Please pay the fine to return the book.\n";
+            return;
+        }
+        cout << "Fine paid successfully.\n";
+    }
+
+    OpResult result = returnBooking(this, it, date);
+    cout << result.message << "\n";
+    for (const string &note : result.notes)
+        cout << note << "\n";
+}
+
+void User::cancelReservation(const string &bookId)
+{
+    cout << withdrawReservation(this, bookId).message << endl;
+}
+
+// One booking as a listing record; the queue position is shown for reservations when asked
+void renderBooking(ReportRenderer &report, Booking *booking, const string &userId, bool showQueue)
+{
+    report.field("Booking ID", booking->bookingId);
+    report.field("Booking Date", booking->bookingDate);
+    report.field("Borrow Date", booking->borrowDate);
+    report.field("Return Date", booking->returnDate);
+    report.field("Fine", booking->fine);
+    report.field("Booking Type", booking->type == BookingType::RESERVED ? "Reserved" : "Direct Borrow");
+    if (showQueue)
+    {
+        if (booking->type == BookingType::RESERVED)
+            report.field("Queue Position", static_cast<long long>(booking->book->reservationQueue.position(userId)));
+        else if (report.tableMode())
+            report.field("Queue Position", "-");
+    }
+    const Book *book = booking->book;
+    report.field("Book Title", book->status == BookStatus::DELETED ? book->title + " (deleted)" : book->title);
+    report.field("Book Author", book->author);
+    report.field("Book Publisher", book->publisher);
+    report.field("Book ISBN", book->ISBN);
+    report.field("Book Year", book->year);
+}
+
+void User::showHistory(const ReportOptions &options)
+{
+    if (account.history.empty())
+    {
+        *options.out << "No history to show" << endl;
+        return;
+    }
+
+    ReportRenderer report(options, account.history.size());
+    for (auto &i : account.history)
+    {
+        if (!report.beginRecord())
+        {
+            if (report.done())
+                break;
+            continue;
+        }
+        renderBooking(report, i.second, UniqueId, false);
+        report.endRecord();
+    }
+}
+
+bool User::authenticate(const string &password) const
+{
+    return verifyPassword(password, credential);
+}
+
+void Student::current_booking(Date date, const ReportOptions &options)
+{
+    if (account.current.empty())
+    {
+        *options.out << "Nothing to show" << endl;
+        return;
+    }
+
+    ReportRenderer report(options, account.current.size());
+    for (auto &i : account.current)
+    {
+        if (!report.beginRecord())
+        {
+            if (report.done())
+                break;
+            continue;
+        }
+        Booking *booking = i.second;
+        if (booking->type != BookingType::RESERVED)
+            booking->fine = calculateFine(booking->borrowDate, date);
+        else
+            booking->fine = 0;
+        renderBooking(report, booking, UniqueId, true);
+        report.endRecord();
+    }
+}
+
+void Faculty::current_booking(Date, const ReportOptions &options)
+{
+    if (account.current.empty())
+    {
+        *options.out << "Nothing to show" << endl;
+        return;
+    }
+
+    ReportRenderer report(options, account.current.size());
+    for (auto &i : account.current)
+    {
+        if (!report.beginRecord())
+        {
+            if (report.done())
+                break;
+            continue;
+        }
+        Booking *booking = i.second;
+        booking->fine = 0;
+        renderBooking(report, booking, UniqueId, true);
+        report.endRecord();
+    }
+}
+
+void User::list_books(const ReportOptions &options)
+{
+    if (library.books.empty())
+    {
+        *options.out << "No books available in the library." << endl;
+        return;
+    }
+
+    ReportRenderer report(options, library.books.size());
+    report.text("List of all books in the library:");
+    report.text("----------------------------------------");
+    for (Book *book : library.books.sorted())
+    {
+        if (!report.beginRecord())
+        {
+            if (report.done())
+                break;
+            continue;
+        }
+        report.field("Book ID", book->bookId);
+        report.field("Title", book->title);
+        report.field("Author", book->author);
+        report.field("Publisher", book->publisher);
+        report.field("ISBN", book->ISBN);
+        report.field("Year", book->year);
+        report.field("Status", book->status == BookStatus::AVAILABLE ? "Available" : "Borrowed");
+        report.field("Reservations in queue", static_cast<long long>(book->reservationQueue.size()));
+        report.endRecord();
+    }
+}
+
+void User::searchBooks()
+{
+    SearchQuery query;
+
+    cout << "Enter keywords from the title, author or publisher (blank for any): ";
+    cin.ignore();
+    getline(cin, query.text);
+
+    cout << "Enter ISBN (- for any): ";
+    string ISBN;
+    cin >> ISBN;
+    if (ISBN != "-")
+        query.ISBN = ISBN;
+
+    cout << "Enter year range FROM TO (0 for an open end, 0 0 for any): ";
+    int yearFrom = 0, yearTo = 0;
+    cin >> yearFrom >> yearTo;
+    if (yearFrom != 0)
+        query.yearFrom = yearFrom;
+    if (yearTo != 0)
+        query.yearTo = yearTo;
+
+    cout << "Enter status (any/available/borrowed): ";
+    string status;
+    cin >> status;
+    if (status == "available" || status == "borrowed")
+    {
+        query.filterStatus = true;
+        query.status = (status == "available") ? BookStatus::AVAILABLE : BookStatus::BORROWED;
+    }
+
+    while (true)
+    {
+        auto startTime = chrono::steady_clock::now();
+        SearchResult result = catalogSearch.search(query);
+        auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startTime);
+
+        if (result.total == 0)
+        {
+            cout << "No matching books found." << endl;
+            return;
+        }
+
+        size_t pages = (result.total + query.pageSize - 1) / query.pageSize;
+        cout << result.total << " matching books (page " << query.page + 1 << " of " << pages << ", "
+             << elapsed.count() << " us)\n";
+        cout << "--------------------------------------------------------------------------------------------------------\n";
+        cout << "Book ID | Title | Author | Year | Status\n";
+        cout << "--------------------------------------------------------------------------------------------------------\n";
+        for (const SearchHit &hit : result.hits)
+        {
+            Book *book = hit.book;
+            cout << book->bookId << " | " << book->title << " | " << book->author << " | " << book->year << " | "
+                 << (book->status == BookStatus::AVAILABLE ? "Available" : "Borrowed") << "\n";
+        }
+        cout << "--------------------------------------------------------------------------------------------------------\n";
+
+        if (query.page + 1 >= pages)
+            return;
+        cout << "Show the next page? (yes/no): ";
+        string choice;
+        cin >> choice;
+        if (choice != "yes")
+            return;
+        query.page++;
+    }
+}
+
+// Student class functions
+Student::Student(string name, string ID, string password) : User(name, ID, password) {}
+
+int Student::tell_fine(Date returnDate)
+{
+    return account.fineOn(returnDate);
+}
+
+string Student::ineligibilityReason(Date date)
+{
+    // Check if the student has a fine greater than 0
+    int totalFine = tell_fine(date);
+    if (totalFine > 0)
+        return "You have a total fine of " + to_string(totalFine) + " rupees. Please pay the fine to borrow a book.";
+
+    // Check if the student has 3 or more books in their current map
+    if (account.current.size() >= 3)
+        return "You have already borrowed or reserved " + to_string(account.current.size()) + " books. Maximum of 3 books are allowed.";
+
+    return "";
+}
+
+void Student::login()
+{
+    cout << "Student logged in successfully. Welcome, " << name << "!\n";
+    Date date = readTodaysDate();
+    while (true)
+    {
+        cout << "\nWhat would you like to do?\n";
+        cout << "1. Borrow Book\n";
+        cout << "2. Return Book\n";
+        cout << "3. View Booking History\n";
+        cout << "4. View Current Booking Status\n";
+        cout << "5. List Books in Library\n";
+        cout << "6. Search Books\n";
+        cout << "7. Log Out\n";
+        cout << "Enter your choice: \n";
+
+        int choice;
+        cin >> choice;
+
+        switch (choice)
+        {
+        case 1:
+        {
+            borrowBook(date);
+            break;
+        }
+        case 2:
+        {
+            returnBook(date);
+            break;
+        }
+        case 3:
+            showHistory(reportOptions);
+            break;
+        case 4:
+            current_booking(date, reportOptions);
+            break;
+        case 5:
+            list_books(reportOptions);
+            break;
+        case 6:
+            searchBooks();
+            break;
+        case 7:
+            cout << "Logging out...\n";
+            return;
+        default:
+            cout << "Invalid choice. Please try again.\n";
+        }
+    }
+}
+
+// Faculty class functions
+Faculty::Faculty(string name, string ID, string password) : User(name, ID, password) {}
+
+string Faculty::ineligibilityReason(Date date)
+{
+    // Check if the faculty has 5 or more books in their current map
+    if (account.current.size() >= 5)
+        return "You have already borrowed or reserved " + to_string(account.current.size()) + " books. Maximum of 5 books are allowed.";
+
+    // Check if the faculty has any book borrowed more than 90 days ago
+    Date earliest = account.earliestBorrow();
+    if (earliest.isSet() && date - earliest > blockDays)
+        return "You have a book borrowed more than 90 days ago. Please return it to borrow a new book.";
+
+    return "";
+}
+
+void Faculty::login()
+{
+    cout << "Faculty logged in successfully. Welcome, " << name << "!\n";
+    Date date = readTodaysDate();
+    while (true)
+    {
+        cout << "\nWhat would you like to do?\n";
+        cout << "1. Borrow Book\n";
+        cout << "2. Return Book\n";
+        cout << "3. View Booking History\n";
+        cout << "4. View Current Booking Status\n";
+        cout << "5. List Books in Library\n";
+        cout << "6. Search Books\n";
+        cout << "7. Log Out\n";
+        cout << "Enter your choice: ";
+
+        int choice;
+        cin >> choice;
+
+        switch (choice)
+        {
+        case 1:
+        {
+
+            borrowBook(date);
+            break;
+        }
+        case 2:
+        {
+            returnBook(date);
+            break;
+        }
+        case 3:
+            showHistory(reportOptions);
+            break;
+        case 4:
+            current_booking(date, reportOptions);
+            break;
+        case 5:
+            list_books(reportOptions);
+            break;
+        case 6:
+            searchBooks();
+            break;
+        case 7:
+            cout << "Logging out...\n";
+            return;
+        default:
+            cout << "Invalid choice. Please try again.\n";
+        }
+    }
+}
+
+// Librarian class functions
+Librarian::Librarian(string name, string ID, string password) : User(name, ID, password) {}
+
+void Librarian::addNewUser()
+{
+    cout << "Select the user type\n1. Student\n2. Faculty\n";
+    int type;
+    cin >> type;
     cout << "Enter the name\n";
     string name;
     cin >> name;
-    string uniqueId = generateUniqueId();
     cout << "Enter password\n";
     string pass;
     cin >> pass;
-    switch (type)
+
+    OpResult result = registerUser(type == 1 ? "student" : type == 2 ? "faculty" : "", name, pass);
+    cout << result.message << "\n";
+}
+
+void Librarian::addNewBook()
+{
+    string title, author, publisher, ISBN;
+    int year;
+
+    cout << "Enter book title: ";
+    cin.ignore();
+    getline(cin, title);
+
+    cout << "Enter book author: ";
+    getline(cin, author);
+
+    cout << "Enter book publisher: ";
+    getline(cin, publisher);
+
+    cout << "Enter book ISBN: ";
+    cin >> ISBN;
+
+    cout << "Enter book year: ";
+    cin >> year;
+
+    cout << registerBook(title, author, publisher, ISBN, year).message << endl;
+}
+
+void Librarian::listUsers(const ReportOptions &options)
+{
+    // Users are always listed one per line
+    ReportOptions tableOptions = options;
+    tableOptions.table = true;
+    vector<const UserEntry *> users = library.usersByRole();
+    size_t borrowers = count_if(users.begin(), users.end(), [](const UserEntry *entry)
+                                { return entry->role != Role::LIBRARIAN; });
+    ReportRenderer report(tableOptions, borrowers);
+
+    report.text("List of all users:");
+    report.text("--------------------------------------------------------------------------------------------------------");
+    report.text("Type      | ID    | Name");
+    report.text("--------------------------------------------------------------------------------------------------------");
+
+    for (const UserEntry *entry : users)
+    {
+        if (entry->role == Role::LIBRARIAN)
+            continue;
+        if (!report.beginRecord())
+        {
+            if (report.done())
+                break;
+            continue;
+        }
+        string type = entry->role == Role::STUDENT ? "Student   " : "Faculty   ";
+        report.text(type + "| " + entry->user->UniqueId + " | " + entry->user->name);
+        report.endRecord();
+    }
+
+    report.text("--------------------------------------------------------------------------------------------------------");
+}
+
+void Librarian::login()
+{
+    cout << "Librarian logged in successfully. Welcome, " << name << "!\n";
+
+    while (true)
+    {
+        cout << "\nWhat would you like to do?\n";
+        cout << "1. Add New User\n";
+        cout << "2. Add New Book\n";
+        cout << "3. List Users\n";
+        cout << "4. List Books in Library\n";
+        cout << "5. Delete User\n";
+        cout << "6. Delete Book\n";
+        cout << "7. Search Books\n";
+        cout << "8. Memory Usage\n";
+        cout << "9. Log Out\n";
+        cout << "Enter your choice: ";
+
+        int choice;
+        cin >> choice;
+
+        switch (choice)
+        {
+        case 1:
+            addNewUser();
+            break;
+        case 2:
+            addNewBook();
+            break;
+        case 3:
+            listUsers(reportOptions);
+            break;
+        case 4:
+            list_books(reportOptions);
+            break;
+        case 5:
+            deleteUser();
+            break;
+        case 6:
+            deleteBook();
+            break;
+        case 7:
+            searchBooks();
+            break;
+        case 8:
+            printMemoryReport(cout);
+            break;
+        case 9:
+            cout << "Logging out...\n";
+            return;
+        default:
+            cout << "Invalid choice. Please try again.\n";
+        }
+    }
+}
+
+void Librarian::deleteUser()
+{
+    cout << "Enter the ID of the user to delete: ";
+    string userId;
+    cin >> userId;
+    cout << removeUser(userId).message << "\n";
+}
+
+// Function to delete a book
+void Librarian::deleteBook()
+{
+    cout << "Enter the ID of the book to delete: ";
+    string bookId;
+    cin >> bookId;
+    cout << removeBook(bookId).message << "\n";
+}
+
+// Login function
+void login()
+{
+    string userType, ID, password;
+
+    cout << "Enter user type (student/faculty/librarian): ";
+    cin >> userType;
+
+    cout << "Enter your ID: ";
+    cin >> ID;
+    cout << "Enter your password: ";
+    cin >> password;
+
+    Role role;
+    if (!parseRole(userType, role))
+    {
+        cout << "Invalid user type. Use 'student', 'faculty', or 'librarian'.\n";
+        return;
+    }
+
+    const UserEntry *entry = library.findEntry(ID);
+    if (entry && entry->role == role && checkLogin(entry, password))
+    {
+        entry->user->login();
+    }
+    else
+    {
+        cout << "Invalid ID or password for " << userType << ".\n";
+    }
+}
+
+// CSV row layouts shared by library_data.csv and the change journal
+// The append* forms add a row to a buffer without temporaries; saveToCSV formats whole
+// sections with them
+void appendInt(string &out, long long value)
+{
+    char digits[24];
+    auto [end, error] = to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end);
+}
+
+void appendBookRow(string &out, const Book *book)
+{
+    out += book->bookId;
+    out += ',';
+    out += book->title;
+    out += ',';
+    out += book->author;
+    out += ',';
+    out += book->publisher;
+    out += ',';
+    out += book->ISBN;
+    out += ',';
+    appendInt(out, book->year);
+    out += ',';
+    out += bookStatusName(book->status);
+    out += ',';
+    for (const string &userId : book->reservationQueue)
+    {
+        out += userId;
+        out += ';';
+    }
+}
+
+void appendUserRow(string &out, const User *user, string_view userType)
+{
+    out += user->UniqueId;
+    out += ',';
+    out += user->name;
+    out += ',';
+    out += user->getCredential();
+    out += ',';
+    out += userType;
+}
+
+void appendBookingRow(string &out, const Booking *booking)
+{
+    out += booking->bookingId;
+    out += ',';
+    out += booking->user->UniqueId;
+    out += ',';
+    out += booking->book->bookId;
+    out += ',';
+    booking->bookingDate.appendTo(out);
+    out += ',';
+    booking->borrowDate.appendTo(out);
+    out += ',';
+    booking->returnDate.appendTo(out);
+    out += ',';
+    appendInt(out, booking->fine);
+    out += ',';
+    out += booking->type == BookingType::RESERVED ? "Reserved" : "DirectBorrow";
+}
+
+string bookRow(const Book *book)
+{
+    string row;
+    appendBookRow(row, book);
+    return row;
+}
+
+string userRow(const User *user, const string &userType)
+{
+    string row;
+    appendUserRow(row, user, userType);
+    return row;
+}
+
+string bookingRow(const Booking *booking)
+{
+    string row;
+    appendBookingRow(row, booking);
+    return row;
+}
+
+// Flushes a file (or directory) to stable storage
+void syncPath(const string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// Renames a fully written temporary file over `path`, so a crash leaves either the old
+// or the new contents, never a truncated file
+bool replaceFile(const string &tempPath, const string &path)
+{
+    syncPath(tempPath);
+    if (rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        cerr << "Error: Could not replace " << path << "\n";
+        return false;
+    }
+    syncPath(".");
+    return true;
+}
+
+// The file is laid out as a list of parts: section headers and chunks of rows. Each
+// chunk is formatted into its own buffer on a pool of worker threads, and the buffers
+// are then written in order with one write each.
+void saveToCSV(const string &path)
+{
+    const size_t bookChunk = 4096, userChunk = 1024;
+    vector<Book *> books = library.books.sorted();
+    for (const auto &bookPair : library.deletedBooks)
+        books.push_back(bookPair.second);
+    vector<const UserEntry *> users = library.usersByRole();
+
+    vector<string> parts;
+    vector<function<void(string &)>> formatters; // One per part; headers have none
+    auto header = [&](const char *text)
+    {
+        parts.emplace_back(text);
+        formatters.emplace_back();
+    };
+    auto chunks = [&](size_t count, size_t chunkSize, auto formatRange)
+    {
+        for (size_t begin = 0; begin < count; begin += chunkSize)
+        {
+            size_t end = min(count, begin + chunkSize);
+            parts.emplace_back();
+            formatters.emplace_back([formatRange, begin, end](string &out)
+                                    { formatRange(out, begin, end); });
+        }
+    };
+
+    header("Books\nBookID,Title,Author,Publisher,ISBN,Year,Status,ReservationQueue\n");
+    chunks(books.size(), bookChunk, [&books](string &out, size_t begin, size_t end)
+           {
+        for (size_t i = begin; i < end; i++)
+        {
+            appendBookRow(out, books[i]);
+            out += '\n';
+        } });
+    header("\nUsers\nUserID,Name,Password,UserType\n");
+    chunks(users.size(), userChunk, [&users](string &out, size_t begin, size_t end)
+           {
+        for (size_t i = begin; i < end; i++)
+        {
+            appendUserRow(out, users[i]->user, roleName(users[i]->role));
+            out += '\n';
+        } });
+    header("\nCurrentBookings\nBookingID,UserID,BookID,BookingDate,BorrowDate,ReturnDate,Fine,Type\n");
+    chunks(users.size(), userChunk, [&users](string &out, size_t begin, size_t end)
+           {
+        for (size_t i = begin; i < end; i++)
+            for (const auto &bookingPair : users[i]->user->account.current)
+            {
+                appendBookingRow(out, bookingPair.second);
+                out += '\n';
+            } });
+    header("\nHistoryBookings\nBookingID,UserID,BookID,BookingDate,BorrowDate,ReturnDate,Fine,Type\n");
+    chunks(users.size(), userChunk, [&users](string &out, size_t begin, size_t end)
+           {
+        for (size_t i = begin; i < end; i++)
+            for (const auto &bookingPair : users[i]->user->account.history)
+            {
+                appendBookingRow(out, bookingPair.second);
+                out += '\n';
+            } });
+
+    parallelFor(parts.size(), [&](size_t i)
+                {
+        if (formatters[i])
+            formatters[i](parts[i]); });
+
+    const string tempPath = path + ".tmp";
+    ofstream file(tempPath, ios::binary);
+    for (const string &part : parts)
+        file.write(part.data(), part.size());
+    file.close();
+    if (file.fail())
+    {
+        cerr << "Error: Could not write " << tempPath << "\n";
+        return;
+    }
+    if (replaceFile(tempPath, path))
+        cout << "Library data saved to " << path << "\n";
+}
+
+// Read-only memory mapping of a whole file, used by the loaders
+class MappedFile
+{
+    const char *start = nullptr;
+    size_t length = 0;
+    bool opened = false;
+
+public:
+    explicit MappedFile(const string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0)
+        {
+            opened = true;
+            length = static_cast<size_t>(info.st_size);
+            if (length > 0)
+            {
+                void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED)
+                {
+                    opened = false;
+                    length = 0;
+                }
+                else
+                {
+                    madvise(mapped, length, MADV_SEQUENTIAL);
+                    start = static_cast<const char *>(mapped);
+                }
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (start)
+            munmap(const_cast<char *>(start), length);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return opened; }
+    string_view view() const { return string_view(start, length); }
+};
+
+// Sections of library_data.csv, in the order they are written
+enum class CsvSection
+{
+    NONE,
+    BOOKS,
+    USERS,
+    CURRENT_BOOKINGS,
+    HISTORY_BOOKINGS
+};
+
+CsvSection sectionFromHeader(string_view line)
+{
+    if (line == "Books")
+        return CsvSection::BOOKS;
+    if (line == "Users")
+        return CsvSection::USERS;
+    if (line == "CurrentBookings")
+        return CsvSection::CURRENT_BOOKINGS;
+    if (line == "HistoryBookings")
+        return CsvSection::HISTORY_BOOKINGS;
+    return CsvSection::NONE;
+}
+
+// Splits the next field off the front of `rest` (the remainder is left in `rest`)
+string_view nextField(string_view &rest, char separator = ',')
+{
+    size_t pos = rest.find(separator);
+    string_view field = rest.substr(0, pos);
+    rest = (pos == string_view::npos) ? string_view() : rest.substr(pos + 1);
+    return field;
+}
+
+// Parses a leading integer the way stoi does (leading blanks and sign allowed, trailing text ignored)
+errc parseInt(string_view text, int &value)
+{
+    size_t pos = 0;
+    while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos])))
+        pos++;
+    if (pos < text.size() && text[pos] == '+')
+        pos++;
+    const char *first = text.data() + pos;
+    return from_chars(first, text.data() + text.size(), value).ec;
+}
+
+// Rows of library_data.csv (and the journal) parsed and validated, before they are applied.
+// The strings point into the line they were parsed from.
+struct StagedBook
+{
+    string_view bookId, title, author, publisher, ISBN;
+    string_view queue; // userId; userId; ...
+    int year;
+    BookStatus status;
+};
+
+struct StagedUser
+{
+    string_view userId, name, credential;
+    Role role;
+};
+
+struct StagedBooking
+{
+    string_view bookingId, userId, bookId;
+    Date bookingDate, borrowDate, returnDate;
+    int fine;
+    BookingType type;
+};
+
+// Each stage*Row returns false for a row to skip, with the reason in `problem` (empty for
+// rows that are skipped silently)
+bool stageBookRow(string_view line, StagedBook &row, string &problem)
+{
+    string_view rest = line;
+    row.bookId = nextField(rest);
+    row.title = nextField(rest);
+    row.author = nextField(rest);
+    row.publisher = nextField(rest);
+    row.ISBN = nextField(rest);
+    string_view yearStr = nextField(rest);
+    string_view status = nextField(rest);
+    row.queue = rest; // The rest of the line is the reservation queue
+
+    // Validate year (ensure it's a valid integer)
+    row.year = 0;
+    errc ec = parseInt(yearStr, row.year);
+    if (ec == errc::invalid_argument)
+    {
+        problem = "Invalid year for book " + string(row.bookId) + ": " + string(yearStr);
+        return false;
+    }
+    if (ec == errc::result_out_of_range)
+    {
+        problem = "Year out of range for book " + string(row.bookId) + ": " + string(yearStr);
+        return false;
+    }
+
+    if (status == "Deleted")
+        row.status = BookStatus::DELETED;
+    else
+        row.status = status == "Available" ? BookStatus::AVAILABLE : BookStatus::BORROWED;
+    return true;
+}
+
+bool stageUserRow(string_view line, StagedUser &row)
+{
+    string_view rest = line;
+    row.userId = nextField(rest);
+    row.name = nextField(rest);
+    row.credential = nextField(rest);
+    return parseRole(nextField(rest), row.role);
+}
+
+bool stageBookingRow(string_view line, StagedBooking &row, string &problem)
+{
+    string_view rest = line;
+    row.bookingId = nextField(rest);
+    row.userId = nextField(rest);
+    row.bookId = nextField(rest);
+    string_view bookingDateStr = nextField(rest);
+    string_view borrowDateStr = nextField(rest);
+    string_view returnDateStr = nextField(rest);
+    string_view fineStr = nextField(rest);
+    string_view typeStr = nextField(rest);
+
+    // Dates are parsed once here and kept as day numbers
+    if (!Date::parse(bookingDateStr, row.bookingDate) || !Date::parse(borrowDateStr, row.borrowDate) ||
+        !Date::parse(returnDateStr, row.returnDate))
+    {
+        problem = "Invalid date for booking " + string(row.bookingId);
+        return false;
+    }
+
+    // Validate fine (ensure it's a valid integer)
+    row.fine = 0;
+    errc ec = parseInt(fineStr, row.fine);
+    if (ec == errc::invalid_argument)
+    {
+        problem = "Invalid fine for booking " + string(row.bookingId) + ": " + string(fineStr);
+        return false;
+    }
+    if (ec == errc::result_out_of_range)
+    {
+        problem = "Fine out of range for booking " + string(row.bookingId) + ": " + string(fineStr);
+        return false;
+    }
+
+    row.type = typeStr == "Reserved" ? BookingType::RESERVED : BookingType::DIRECT_BORROW;
+    return true;
+}
+
+Book *newBook(const StagedBook &row)
+{
+    Book *book = bookPool.create(string(row.bookId), string(row.title), string(row.author), string(row.publisher),
+                                 string(row.ISBN), row.year);
+    book->status = row.status;
+    string_view queue = row.queue;
+    while (book->status != BookStatus::DELETED && !queue.empty())
+    {
+        string_view userId = nextField(queue, ';');
+        if (!userId.empty())
+            book->reservationQueue.push(string(userId));
+    }
+    return book;
+}
+
+void loadBookRow(string_view line)
+{
+    StagedBook row;
+    string problem;
+    if (!stageBookRow(line, row, problem))
+    {
+        cerr << problem << "\n";
+        return; // Skip this book
+    }
+    string bookId(row.bookId);
+    idAllocator.observe(IdKind::BOOK, bookId);
+
+    // Deleted books come back as tombstones, outside the catalog
+    if (row.status == BookStatus::DELETED)
+    {
+        Book *tombstone = findBookRecord(bookId);
+        if (tombstone == nullptr)
+            library.deletedBooks[bookId] = newBook(row);
+        else if (tombstone->status != BookStatus::DELETED)
+            retireBook(tombstone);
+        return;
+    }
+
+    // Journal replay updates books that are already loaded
+    Book *book = library.books.find(bookId);
+    if (!book)
+    {
+        book = newBook(row);
+        catalogSearch.add(book);
+        library.books.insert(book);
+        return;
+    }
+    Book old = *book;
+    *book = Book(bookId, string(row.title), string(row.author), string(row.publisher), string(row.ISBN), row.year);
+    catalogSearch.update(book, old.title, old.author, old.publisher, old.ISBN, old.year);
+    book->status = row.status;
+    string_view queue = row.queue;
+    while (!queue.empty())
+    {
+        string_view userId = nextField(queue, ';');
+        if (!userId.empty())
+            book->reservationQueue.push(string(userId));
+    }
+}
+
+void loadUserRow(string_view line)
+{
+    StagedUser row;
+    if (!stageUserRow(line, row))
+        return;
+    string userId(row.userId);
+
+    // Journal replay updates users that are already loaded, keeping their accounts
+    const UserEntry *entry = library.findEntry(userId);
+    if (entry && entry->role == row.role)
+    {
+        entry->user->name = string(row.name);
+        entry->user->setCredential(string(row.credential));
+        return;
+    }
+    destroyUser(userId); // A user whose type changed is recreated
+
+    static const IdKind idKinds[] = {IdKind::STUDENT, IdKind::FACULTY, IdKind::LIBRARIAN};
+    idAllocator.observe(idKinds[static_cast<int>(row.role)], userId);
+    createUser(row.role, string(row.name), userId, string(row.credential));
+}
+
+// A student or faculty member (the users who hold bookings), or nullptr for any other ID
+User *findBorrower(const string &userId)
+{
+    const UserEntry *entry = library.findEntry(userId);
+    return entry && entry->role != Role::LIBRARIAN ? entry->user : nullptr;
+}
+
+// Puts a loaded booking in its user's account, replacing any copy of it already there
+void attachBooking(User *user, Booking *booking, bool current)
+{
+    // Journal replay supersedes a booking that is already current
+    bookingPool.destroy(user->account.removeCurrent(booking->bookingId));
+
+    if (current)
+        user->account.addCurrent(booking);
+    else
+        bookingPool.destroy(user->account.addHistory(booking)); // Replaces the copy of a replayed history record
+}
+
+// Resolves a booking row's book and user; returns nullptr and the reason if either is missing
+Booking *linkBooking(const StagedBooking &row, string &problem)
+{
+    string bookingId(row.bookingId);
+    Book *book = findBookRecord(string(row.bookId));
+    if (book == nullptr)
+    {
+        problem = "Unknown book " + string(row.bookId) + " for booking " + bookingId;
+        return nullptr;
+    }
+
+    User *user = findBorrower(string(row.userId));
+    if (user == nullptr)
+    {
+        problem = "Unknown user " + string(row.userId) + " for booking " + bookingId;
+        return nullptr;
+    }
+
+    idAllocator.observe(IdKind::BOOKING, bookingId);
+    return bookingPool.create(bookingId, book, user, row.bookingDate, row.borrowDate, row.returnDate, row.fine,
+                              row.type);
+}
+
+void loadBookingRow(string_view line, CsvSection section)
+{
+    StagedBooking row;
+    string problem;
+    Booking *booking = stageBookingRow(line, row, problem) ? linkBooking(row, problem) : nullptr;
+    if (!booking)
+    {
+        cerr << problem << "\n";
+        return; // Skip this booking
+    }
+    attachBooking(booking->user, booking, section == CsvSection::CURRENT_BOOKINGS);
+}
+
+// Applies one journal record on top of the loaded snapshot
+void applyJournalRecord(string_view line)
+{
+    string_view row = line;
+    string_view tag = nextField(row);
+
+    if (tag == "Book")
+    {
+        loadBookRow(row);
+    }
+    else if (tag == "User")
+    {
+        loadUserRow(row);
+    }
+    else if (tag == "Current")
+    {
+        loadBookingRow(row, CsvSection::CURRENT_BOOKINGS);
+    }
+    else if (tag == "History")
+    {
+        loadBookingRow(row, CsvSection::HISTORY_BOOKINGS);
+    }
+    else if (tag == "Drop")
+    {
+        string userId(nextField(row));
+        string bookingId(nextField(row));
+        User *user = findBorrower(userId);
+        if (user)
+            bookingPool.destroy(user->account.removeCurrent(bookingId));
+    }
+    else if (tag == "DeleteBook")
+    {
+        if (Book *book = library.books.find(row))
+            retireBook(book);
+    }
+    else if (tag == "DeleteUser")
+    {
+        destroyUser(string(row));
+    }
+    else
+    {
+        cerr << "Unknown journal record: " << line << "\n";
+    }
+}
+
+// Replays library_data.journal over the snapshot and reopens it for appending
+void replayJournal()
+{
+    off_t validLength = 0;
+    size_t records = 0;
+    {
+        MappedFile file("library_data.journal");
+        string_view data = file.view();
+        size_t position = 0;
+        vector<string_view> transaction; // Records since Begin, applied at Commit
+        bool inTransaction = false;
+        while (position < data.size())
+        {
+            size_t end = data.find('\n', position);
+            if (end == string_view::npos)
+                break; // A record torn by a crash is discarded
+
+            string_view line = data.substr(position, end - position);
+            position = end + 1;
+            if (line == "Begin")
+            {
+                transaction.clear();
+                inTransaction = true;
+                continue;
+            }
+            if (line == "Commit")
+            {
+                for (string_view record : transaction)
+                    applyJournalRecord(record);
+                records += transaction.size();
+                transaction.clear();
+                inTransaction = false;
+            }
+            else if (inTransaction)
+            {
+                transaction.push_back(line);
+                continue;
+            }
+            else
+            {
+                applyJournalRecord(line);
+                records++;
+            }
+            validLength = position;
+        }
+        // A transaction without its Commit is discarded along with anything torn
+    }
+
+    journal.open("library_data.journal", validLength, records);
+    if (records > 0)
+        cout << "Replayed " << records << " journal records from library_data.journal\n";
+    if (journal.needsCompaction())
+        compactJournal();
+}
+
+// A run of rows from one section of library_data.csv, parsed by one loader worker
+struct LoadChunk
+{
+    CsvSection section = CsvSection::NONE;
+    string_view text = {};
+    size_t rows = 0;
+    vector<StagedBook> books = {};
+    vector<StagedUser> users = {};
+    vector<StagedBooking> bookings = {};
+    vector<Book *> bookObjects = {};       // Parallel to `books`
+    vector<User *> userObjects = {};       // Parallel to `users`
+    vector<vector<Booking *>> linked = {}; // Resolved bookings by user partition, in file order
+    vector<string> problems = {};          // Rows skipped, in file order within each pass
+    size_t unknownBooks = 0, unknownUsers = 0;
+};
+
+// Cuts `text` into pieces of about `size` bytes that end at line breaks
+vector<string_view> splitAtLines(string_view text, size_t size)
+{
+    vector<string_view> pieces;
+    while (!text.empty())
+    {
+        size_t end = text.size() <= size ? string_view::npos : text.find('\n', size);
+        end = end == string_view::npos ? text.size() : end + 1;
+        pieces.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return pieces;
+}
+
+// Loads the file into an empty library in three parallel passes. First the mapped file is
+// cut into pieces at line breaks, which are scanned for section names. Each section is
+// then cut into chunks that are parsed into staged rows. Linking comes last: books and
+// users are created and registered in file order, so a later row for the same ID wins as
+// in the journal, and only then are bookings resolved against them. Bookings whose book
+// or user does not exist are reported and skipped.
+void loadFromCSV(const string &path)
+{
+    auto startTime = chrono::steady_clock::now();
+
+    MappedFile file(path);
+    if (!file.isOpen())
+    {
+        cerr << "Error: Could not open " << path << "\n";
+        return;
+    }
+    string_view data = file.view();
+    const size_t chunkSize = 1 << 20;
+
+    // Pass 1: find the section names and where each section's rows start
+    struct Section
+    {
+        size_t nameStart, bodyStart;
+        CsvSection section;
+    };
+    vector<string_view> pieces = splitAtLines(data, chunkSize);
+    vector<vector<Section>> found(pieces.size());
+    parallelFor(pieces.size(), [&](size_t i)
+                {
+        string_view rest = pieces[i];
+        while (!rest.empty())
+        {
+            size_t lineStart = rest.data() - data.data();
+            string_view line = nextField(rest, '\n');
+            size_t headerStart = lineStart + line.size() + 1;
+            if (line.size() > 16 || line.find(',') != string_view::npos)
+                continue; // Cannot be a section name
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            CsvSection section = sectionFromHeader(line);
+            if (section == CsvSection::NONE)
+                continue;
+            // The line after a section name is the column header, possibly in the next piece
+            size_t headerEnd = headerStart < data.size() ? data.find('\n', headerStart) : string_view::npos;
+            size_t bodyStart = headerEnd == string_view::npos ? data.size() : headerEnd + 1;
+            found[i].push_back(Section{lineStart, bodyStart, section});
+        } });
+
+    vector<Section> sections;
+    for (const auto &piece : found)
+        sections.insert(sections.end(), piece.begin(), piece.end());
+    vector<LoadChunk> chunks;
+    for (size_t s = 0; s < sections.size(); s++)
+    {
+        size_t end = s + 1 < sections.size() ? sections[s + 1].nameStart : data.size();
+        size_t begin = min(sections[s].bodyStart, end);
+        for (string_view text : splitAtLines(data.substr(begin, end - begin), chunkSize))
+            chunks.push_back(LoadChunk{sections[s].section, text});
+    }
+
+    // Pass 2: parse every chunk into staged rows
+    parallelFor(chunks.size(), [&](size_t i)
+                {
+        LoadChunk &chunk = chunks[i];
+        string_view rest = chunk.text;
+        string problem;
+        while (!rest.empty())
+        {
+            string_view line = nextField(rest, '\n');
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.empty())
+                continue;
+            chunk.rows++;
+
+            problem.clear();
+            bool staged = false;
+            switch (chunk.section)
+            {
+            case CsvSection::BOOKS:
+                chunk.books.emplace_back();
+                if (!(staged = stageBookRow(line, chunk.books.back(), problem)))
+                    chunk.books.pop_back();
+                break;
+            case CsvSection::USERS:
+                chunk.users.emplace_back();
+                if (!(staged = stageUserRow(line, chunk.users.back())))
+                    chunk.users.pop_back();
+                break;
+            default:
+                chunk.bookings.emplace_back();
+                if (!(staged = stageBookingRow(line, chunk.bookings.back(), problem)))
+                    chunk.bookings.pop_back();
+                break;
+            }
+            if (!staged && !problem.empty())
+                chunk.problems.push_back(problem);
+        } });
+
+    // Pass 3: create the books and users in parallel, then register them in file order
+    parallelFor(chunks.size(), [&](size_t i)
+                {
+        LoadChunk &chunk = chunks[i];
+        for (const StagedBook &row : chunk.books)
+            chunk.bookObjects.push_back(newBook(row));
+        for (const StagedUser &row : chunk.users)
+            chunk.userObjects.push_back(newUser(row.role, string(row.name), string(row.userId), string(row.credential))); });
+
+    size_t bookCount = 0, userCount = 0;
+    for (const LoadChunk &chunk : chunks)
+    {
+        bookCount += chunk.books.size();
+        userCount += chunk.users.size();
+    }
+    library.books.reserve(bookCount);
+    library.users.reserve(userCount);
+
+    static const IdKind idKinds[] = {IdKind::STUDENT, IdKind::FACULTY, IdKind::LIBRARIAN};
+    vector<Book *> superseded; // Earlier rows for a book ID, freed once the index is built
+    for (LoadChunk &chunk : chunks)
+    {
+        for (Book *book : chunk.bookObjects)
+        {
+            idAllocator.observe(IdKind::BOOK, book->bookId);
+            if (Book *earlier = findBookRecord(book->bookId))
+            {
+                library.books.erase(earlier->bookId);
+                library.deletedBooks.erase(earlier->bookId);
+                superseded.push_back(earlier);
+            }
+            // Deleted books come back as tombstones, outside the catalog
+            if (book->status == BookStatus::DELETED)
+                library.deletedBooks[book->bookId] = book;
+            else
+                library.books.insert(book);
+        }
+        for (size_t u = 0; u < chunk.userObjects.size(); u++)
+        {
+            User *user = chunk.userObjects[u];
+            Role role = chunk.users[u].role;
+            idAllocator.observe(idKinds[static_cast<int>(role)], user->UniqueId);
+            destroyUser(user->UniqueId); // An earlier row for the same ID
+            library.users.emplace(user->UniqueId, UserEntry{role, user});
+        }
+    }
+
+    // The search index is built while bookings are linked, which never touch it
+    thread indexer([&]()
+                   {
+        for (const LoadChunk &chunk : chunks)
+            for (Book *book : chunk.bookObjects)
+                if (book->status != BookStatus::DELETED &&
+                    (superseded.empty() || library.books.find(book->bookId) == book))
+                    catalogSearch.add(book); });
+
+    // Resolve each booking's book and user, sorting the bookings by the user's partition
+    const size_t partitions = max(1u, thread::hardware_concurrency());
+    parallelFor(chunks.size(), [&](size_t i)
+                {
+        LoadChunk &chunk = chunks[i];
+        if (chunk.bookings.empty())
+            return;
+        chunk.linked.resize(partitions);
+        string problem;
+        for (const StagedBooking &row : chunk.bookings)
+        {
+            if (Booking *booking = linkBooking(row, problem))
+            {
+                chunk.linked[hash<string_view>()(row.userId) % partitions].push_back(booking);
+                continue;
+            }
+            chunk.problems.push_back(problem);
+            (findBookRecord(string(row.bookId)) ? chunk.unknownUsers : chunk.unknownBooks)++;
+        } });
+
+    size_t historyRows = 0;
+    for (const LoadChunk &chunk : chunks)
+        if (chunk.section == CsvSection::HISTORY_BOOKINGS)
+            historyRows += chunk.bookings.size();
+    historyStore.reserve(historyRows);
+
+    // Each worker fills the accounts of the users in its partition, so no account is shared
+    parallelFor(partitions, [&](size_t p)
+                {
+        for (const LoadChunk &chunk : chunks)
+            if (!chunk.linked.empty())
+                for (Booking *booking : chunk.linked[p])
+                    attachBooking(booking->user, booking, chunk.section == CsvSection::CURRENT_BOOKINGS); });
+    indexer.join();
+    for (Book *book : superseded)
+        bookPool.destroy(book);
+
+    // A badly damaged file is summarised rather than listed in full
+    const size_t problemLimit = 100;
+    size_t rows = 0, problems = 0, unknownBooks = 0, unknownUsers = 0;
+    for (const LoadChunk &chunk : chunks)
+    {
+        rows += chunk.rows;
+        unknownBooks += chunk.unknownBooks;
+        unknownUsers += chunk.unknownUsers;
+        for (const string &problem : chunk.problems)
+            if (problems++ < problemLimit)
+                cerr << problem << "\n";
+    }
+    if (problems > problemLimit)
+        cerr << "... and " << problems - problemLimit << " more problems\n";
+    if (unknownBooks + unknownUsers > 0)
+        cerr << "Skipped " << unknownBooks + unknownUsers << " bookings with dangling references ("
+             << unknownBooks << " unknown books, " << unknownUsers << " unknown users)\n";
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    double seconds = elapsed.count();
+    cout << "Library data loaded from " << path << " (" << rows << " rows in "
+         << static_cast<long long>(seconds * 1000) << " ms, "
+         << static_cast<long long>(seconds > 0 ? rows / seconds : rows) << " rows/s)\n";
+}
+// Binary snapshot (library_data.snap): a versioned image of the library that can be
+// memory-mapped and queried in place. Every string lives once in an interned string
+// table; books, users and bookings are fixed-width records that refer to strings by index.
+const char snapshotMagic[8] = {'L', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t snapshotVersion = 3; // 3: books may be tombstones (status DELETED)
+const uint32_t oldestSnapshotVersion = 2;
+
+enum class SnapshotFormat
+{
+    CSV,
+    BINARY
+};
+
+// Format of the snapshot the journal applies to; compaction writes the same format
+SnapshotFormat activeSnapshot = SnapshotFormat::CSV;
+
+enum SnapshotSectionId
+{
+    STRING_OFFSETS, // uint32_t[strings + 1], offsets into STRING_DATA
+    STRING_DATA,
+    BOOKS,          // SnapshotBook[], sorted by bookId
+    QUEUE_ENTRIES,  // uint32_t[] user ID strings, referenced by SnapshotBook
+    USERS,          // SnapshotUser[], sorted by userId
+    BOOKINGS,       // SnapshotBooking[], each user's current bookings followed by their history
+    SECTION_COUNT
+};
+
+struct SnapshotSection
+{
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    SnapshotSection sections[SECTION_COUNT];
+};
+
+struct SnapshotBook
+{
+    uint32_t bookId;
+    uint32_t title;
+    uint32_t author;
+    uint32_t publisher;
+    uint32_t ISBN;
+    int32_t year;
+    uint32_t status;
+    uint32_t queueBegin;
+    uint32_t queueCount;
+};
+
+enum class SnapshotRole : uint32_t
+{
+    STUDENT,
+    FACULTY,
+    LIBRARIAN
+};
+
+struct SnapshotUser
+{
+    uint32_t userId;
+    uint32_t name;
+    uint32_t password;
+    SnapshotRole role;
+    uint32_t currentBegin;
+    uint32_t currentCount;
+    uint32_t historyBegin;
+    uint32_t historyCount;
+};
+
+struct SnapshotBooking
+{
+    uint32_t bookingId;
+    uint32_t bookId;
+    int32_t bookingDate; // Day numbers
+    int32_t borrowDate;
+    int32_t returnDate;
+    int32_t fine;
+    uint32_t type;
+};
+
+// Read-only, zero-copy access to a mapped snapshot
+class SnapshotView
+{
+    MappedFile file;
+    const SnapshotHeader *header = nullptr;
+    bool valid = false;
+
+    template <typename T>
+    const T *section(SnapshotSectionId id) const
+    {
+        return reinterpret_cast<const T *>(file.view().data() + header->sections[id].offset);
+    }
+
+public:
+    explicit SnapshotView(const string &path) : file(path)
+    {
+        string_view data = file.view();
+        if (data.size() < sizeof(SnapshotHeader))
+            return;
+        header = reinterpret_cast<const SnapshotHeader *>(data.data());
+        if (memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic)) != 0 || header->version < oldestSnapshotVersion ||
+            header->version > snapshotVersion)
+            return;
+
+        const size_t recordSizes[SECTION_COUNT] = {sizeof(uint32_t), 1, sizeof(SnapshotBook), sizeof(uint32_t),
+                                                   sizeof(SnapshotUser), sizeof(SnapshotBooking)};
+        for (int id = 0; id < SECTION_COUNT; id++)
+        {
+            const SnapshotSection &s = header->sections[id];
+            if (s.offset > data.size() || s.count > (data.size() - s.offset) / recordSizes[id])
+                return;
+        }
+        if (header->sections[STRING_OFFSETS].count == 0)
+            return;
+        const uint32_t *offsets = section<uint32_t>(STRING_OFFSETS);
+        for (uint64_t i = 0; i < header->sections[STRING_OFFSETS].count; i++)
+        {
+            if (offsets[i] > header->sections[STRING_DATA].count || (i > 0 && offsets[i] < offsets[i - 1]))
+                return;
+        }
+
+        // Enum fields are cast straight to their types, so an out-of-range value is corruption
+        const SnapshotBook *books = section<SnapshotBook>(BOOKS);
+        for (uint64_t i = 0; i < header->sections[BOOKS].count; i++)
+        {
+            if (books[i].status > static_cast<uint32_t>(BookStatus::DELETED))
+                return;
+        }
+        const SnapshotBooking *bookings = section<SnapshotBooking>(BOOKINGS);
+        for (uint64_t i = 0; i < header->sections[BOOKINGS].count; i++)
+        {
+            if (bookings[i].type > static_cast<uint32_t>(BookingType::DIRECT_BORROW))
+                return;
+        }
+        valid = true;
+    }
+
+    bool isValid() const { return valid; }
+
+    size_t stringCount() const { return header->sections[STRING_OFFSETS].count - 1; }
+    size_t bookCount() const { return header->sections[BOOKS].count; }
+    size_t userCount() const { return header->sections[USERS].count; }
+    size_t bookingCount() const { return header->sections[BOOKINGS].count; }
+    size_t queueEntryCount() const { return header->sections[QUEUE_ENTRIES].count; }
+
+    // Interned string by index (empty for an out-of-range index)
+    string_view str(uint32_t index) const
+    {
+        if (index >= stringCount())
+            return string_view();
+        const uint32_t *offsets = section<uint32_t>(STRING_OFFSETS);
+        return string_view(section<char>(STRING_DATA) + offsets[index], offsets[index + 1] - offsets[index]);
+    }
+
+    const SnapshotBook &book(size_t i) const { return section<SnapshotBook>(BOOKS)[i]; }
+    const SnapshotUser &user(size_t i) const { return section<SnapshotUser>(USERS)[i]; }
+    const SnapshotBooking &booking(size_t i) const { return section<SnapshotBooking>(BOOKINGS)[i]; }
+    uint32_t queueEntry(size_t i) const { return section<uint32_t>(QUEUE_ENTRIES)[i]; }
+
+    // Binary search over the sorted book records
+    const SnapshotBook *findBook(string_view bookId) const
+    {
+        size_t low = 0, high = bookCount();
+        while (low < high)
+        {
+            size_t mid = (low + high) / 2;
+            int order = str(book(mid).bookId).compare(bookId);
+            if (order == 0)
+                return &book(mid);
+            if (order < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return nullptr;
+    }
+
+    // Binary search over the sorted user records
+    const SnapshotUser *findUser(string_view userId) const
+    {
+        size_t low = 0, high = userCount();
+        while (low < high)
+        {
+            size_t mid = (low + high) / 2;
+            int order = str(user(mid).userId).compare(userId);
+            if (order == 0)
+                return &user(mid);
+            if (order < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return nullptr;
+    }
+};
+
+// Builds the interned string table while a snapshot is written
+class StringTable
+{
+    unordered_map<string, uint32_t> indexOf;
+
+public:
+    vector<uint32_t> offsets = {0};
+    string data;
+
+    uint32_t intern(const string &text)
+    {
+        auto it = indexOf.find(text);
+        if (it != indexOf.end())
+            return it->second;
+        uint32_t index = static_cast<uint32_t>(offsets.size() - 1);
+        indexOf.emplace(text, index);
+        data += text;
+        offsets.push_back(static_cast<uint32_t>(data.size()));
+        return index;
+    }
+};
+
+template <typename T>
+void appendSection(string &image, SnapshotHeader &header, SnapshotSectionId id, const T *records, size_t count)
+{
+    image.resize((image.size() + 7) & ~size_t(7), '\0'); // 8-byte aligned sections
+    header.sections[id].offset = image.size();
+    header.sections[id].count = count;
+    image.append(reinterpret_cast<const char *>(records), count * sizeof(T));
+}
+
+void saveBinarySnapshot(const string &path)
+{
+    StringTable strings;
+    vector<SnapshotBook> books;
+    vector<uint32_t> queueEntries;
+    vector<SnapshotUser> users;
+    vector<SnapshotBooking> bookings;
+
+    // Catalog books and tombstones are merged into one list sorted by ID
+    vector<Book *> allBooks = library.books.sorted();
+    allBooks.reserve(library.books.size() + library.deletedBooks.size());
+    for (const auto &bookPair : library.deletedBooks)
+        allBooks.push_back(bookPair.second);
+    inplace_merge(allBooks.begin(), allBooks.begin() + library.books.size(), allBooks.end(),
+                  [](const Book *a, const Book *b) { return a->bookId < b->bookId; });
+
+    for (Book *book : allBooks)
+    {
+        SnapshotBook record = {};
+        record.bookId = strings.intern(book->bookId);
+        record.title = strings.intern(book->title);
+        record.author = strings.intern(book->author);
+        record.publisher = strings.intern(book->publisher);
+        record.ISBN = strings.intern(book->ISBN);
+        record.year = book->year;
+        record.status = static_cast<uint32_t>(book->status);
+        record.queueBegin = static_cast<uint32_t>(queueEntries.size());
+        for (const string &userId : book->reservationQueue)
+            queueEntries.push_back(strings.intern(userId));
+        record.queueCount = static_cast<uint32_t>(queueEntries.size() - record.queueBegin);
+        books.push_back(record);
+    }
+
+    // Users of all three roles are stored in one list sorted by ID
+    vector<const UserEntry *> allUsers;
+    allUsers.reserve(library.users.size());
+    for (const auto &entry : library.users)
+        allUsers.push_back(&entry.second);
+    sort(allUsers.begin(), allUsers.end(), [](const UserEntry *a, const UserEntry *b)
+         { return a->user->UniqueId < b->user->UniqueId; });
+
+    auto appendBookings = [&](const map<string, Booking *> &source)
+    {
+        for (const auto &bookingPair : source)
+        {
+            Booking *booking = bookingPair.second;
+            SnapshotBooking record = {};
+            record.bookingId = strings.intern(booking->bookingId);
+            record.bookId = strings.intern(booking->book->bookId);
+            record.bookingDate = booking->bookingDate.days();
+            record.borrowDate = booking->borrowDate.days();
+            record.returnDate = booking->returnDate.days();
+            record.fine = booking->fine;
+            record.type = static_cast<uint32_t>(booking->type);
+            bookings.push_back(record);
+        }
+    };
+
+    for (const UserEntry *entry : allUsers)
+    {
+        User *user = entry->user;
+        SnapshotUser record = {};
+        record.userId = strings.intern(user->UniqueId);
+        record.name = strings.intern(user->name);
+        record.password = strings.intern(user->getCredential());
+        record.role = entry->role == Role::STUDENT   ? SnapshotRole::STUDENT
+                      : entry->role == Role::FACULTY ? SnapshotRole::FACULTY
+                                                     : SnapshotRole::LIBRARIAN;
+        record.currentBegin = static_cast<uint32_t>(bookings.size());
+        appendBookings(user->account.current);
+        record.currentCount = static_cast<uint32_t>(bookings.size() - record.currentBegin);
+        record.historyBegin = static_cast<uint32_t>(bookings.size());
+        appendBookings(user->account.history);
+        record.historyCount = static_cast<uint32_t>(bookings.size() - record.historyBegin);
+        users.push_back(record);
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+
+    string image(sizeof(SnapshotHeader), '\0');
+    appendSection(image, header, STRING_OFFSETS, strings.offsets.data(), strings.offsets.size());
+    appendSection(image, header, STRING_DATA, strings.data.data(), strings.data.size());
+    appendSection(image, header, BOOKS, books.data(), books.size());
+    appendSection(image, header, QUEUE_ENTRIES, queueEntries.data(), queueEntries.size());
+    appendSection(image, header, USERS, users.data(), users.size());
+    appendSection(image, header, BOOKINGS, bookings.data(), bookings.size());
+    memcpy(&image[0], &header, sizeof(header));
+
+    const string tempPath = path + ".tmp";
+    ofstream file(tempPath, ios::binary);
+    file.write(image.data(), image.size());
+    file.close();
+    if (file.fail())
+    {
+        cerr << "Error: Could not write " << tempPath << "\n";
+        return;
+    }
+    if (replaceFile(tempPath, path))
+        cout << "Library data saved to " << path << "\n";
+}
+
+// Materializes a binary snapshot into the global library
+bool loadBinarySnapshot(const string &path)
+{
+    auto startTime = chrono::steady_clock::now();
+
+    SnapshotView snapshot(path);
+    if (!snapshot.isValid())
+    {
+        cerr << "Error: " << path << " is not a valid library snapshot\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < snapshot.bookCount(); i++)
+    {
+        const SnapshotBook &record = snapshot.book(i);
+        Book *book = bookPool.create(string(snapshot.str(record.bookId)), string(snapshot.str(record.title)),
+                              string(snapshot.str(record.author)), string(snapshot.str(record.publisher)),
+                              string(snapshot.str(record.ISBN)), record.year);
+        book->status = static_cast<BookStatus>(record.status);
+        idAllocator.observe(IdKind::BOOK, book->bookId);
+        if (book->status == BookStatus::DELETED)
+        {
+            library.deletedBooks[book->bookId] = book;
+            continue;
+        }
+        catalogSearch.add(book);
+        for (uint32_t q = 0; q < record.queueCount && record.queueBegin + q < snapshot.queueEntryCount(); q++)
+            book->reservationQueue.push(string(snapshot.str(snapshot.queueEntry(record.queueBegin + q))));
+        library.books.insert(book);
+    }
+
+    auto loadBookings = [&](User *user, bool current, uint32_t begin, uint32_t count)
+    {
+        for (uint32_t b = 0; b < count && begin + b < snapshot.bookingCount(); b++)
+        {
+            const SnapshotBooking &record = snapshot.booking(begin + b);
+            string bookId(snapshot.str(record.bookId));
+            Book *book = findBookRecord(bookId);
+            if (book == nullptr)
+            {
+                cerr << "Unknown book " << bookId << " for booking " << snapshot.str(record.bookingId) << "\n";
+                continue;
+            }
+            Booking *booking = bookingPool.create(
+                string(snapshot.str(record.bookingId)), book, user, Date(record.bookingDate),
+                Date(record.borrowDate), Date(record.returnDate), record.fine, static_cast<BookingType>(record.type));
+            if (current)
+                user->account.addCurrent(booking);
+            else
+                user->account.addHistory(booking);
+            idAllocator.observe(IdKind::BOOKING, booking->bookingId);
+        }
+    };
+
+    for (size_t i = 0; i < snapshot.userCount(); i++)
+    {
+        const SnapshotUser &record = snapshot.user(i);
+        string userId(snapshot.str(record.userId));
+        string name(snapshot.str(record.name));
+        Role role;
+        IdKind kind;
+        switch (record.role)
+        {
+        case SnapshotRole::STUDENT:
+            role = Role::STUDENT;
+            kind = IdKind::STUDENT;
+            break;
+        case SnapshotRole::FACULTY:
+            role = Role::FACULTY;
+            kind = IdKind::FACULTY;
+            break;
+        case SnapshotRole::LIBRARIAN:
+            role = Role::LIBRARIAN;
+            kind = IdKind::LIBRARIAN;
+            break;
+        default:
+            continue;
+        }
+        idAllocator.observe(kind, userId);
+        User *user = createUser(role, name, userId, string(snapshot.str(record.password)));
+        loadBookings(user, true, record.currentBegin, record.currentCount);
+        loadBookings(user, false, record.historyBegin, record.historyCount);
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    cout << "Library data loaded from " << path << " (" << snapshot.bookCount() << " books, "
+         << snapshot.userCount() << " users, " << snapshot.bookingCount() << " bookings in "
+         << static_cast<long long>(elapsed.count() * 1000) << " ms)\n";
+    return true;
+}
+
+// Loads the binary snapshot when one exists, otherwise the CSV
+void loadSnapshot()
+{
+    if (access("library_data.snap", F_OK) == 0)
+    {
+        activeSnapshot = SnapshotFormat::BINARY;
+        loadBinarySnapshot("library_data.snap");
+    }
+    else
+    {
+        activeSnapshot = SnapshotFormat::CSV;
+        loadFromCSV("library_data.csv");
+    }
+}
+
+// Folds the journal into a fresh snapshot and starts an empty journal
+void compactJournal()
+{
+    purgeTombstones();
+    if (activeSnapshot == SnapshotFormat::BINARY)
+        saveBinarySnapshot("library_data.snap");
+    else
+        saveToCSV("library_data.csv");
+    journal.reset();
+    trimPools();
+}
+
+void commitJournal()
+{
+    journal.commit();
+    if (compactOnCommit && journal.needsCompaction())
+        compactJournal();
+}
+
+// Splits a batch line into words; double quotes group words with spaces ("Clean Code")
+vector<string> splitCommand(const string &line)
+{
+    vector<string> words;
+    size_t i = 0;
+    while (i < line.size())
+    {
+        while (i < line.size() && isspace(static_cast<unsigned char>(line[i])))
+            i++;
+        if (i == line.size())
+            break;
+
+        string word;
+        if (line[i] == '"')
+        {
+            size_t close = line.find('"', i + 1);
+            if (close == string::npos)
+                close = line.size();
+            word = line.substr(i + 1, close - i - 1);
+            i = close + 1;
+        }
+        else
+        {
+            while (i < line.size() && !isspace(static_cast<unsigned char>(line[i])))
+                word += line[i++];
+        }
+        words.push_back(word);
+    }
+    return words;
+}
+
+// A logged-in user. The token stands for a password already checked, so a batch script
+// or server connection logs in once and later commands cost one lookup.
+struct Session
+{
+    User *user;
+    Role role;
+};
+
+class SessionTable
+{
+    unordered_map<string, Session> sessions; // By token
+    mutable mutex lock;
+    random_device entropy;
+
+public:
+    // Opens a session and returns its token, 128 random bits in hex
+    string open(User *user, Role role)
+    {
+        lock_guard<mutex> guard(lock);
+        string token;
+        do
+        {
+            unsigned char bytes[16];
+            for (size_t i = 0; i < sizeof(bytes); i += 4)
+            {
+                uint32_t word = entropy();
+                memcpy(bytes + i, &word, 4);
+            }
+            token = toHex(bytes, sizeof(bytes));
+        } while (sessions.count(token));
+        sessions.emplace(token, Session{user, role});
+        return token;
+    }
+
+    bool find(const string &token, Session &session) const
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = sessions.find(token);
+        if (it == sessions.end())
+            return false;
+        session = it->second;
+        return true;
+    }
+
+    void close(const string &token)
+    {
+        lock_guard<mutex> guard(lock);
+        sessions.erase(token);
+    }
+
+    // Ends every session of a user who is being deleted
+    void closeAll(const User *user)
+    {
+        lock_guard<mutex> guard(lock);
+        for (auto it = sessions.begin(); it != sessions.end();)
+            it = it->second.user == user ? sessions.erase(it) : next(it);
+    }
+};
+
+// Global session table; sessions last until logout, the user's deletion or shutdown
+SessionTable sessions;
+
+void endSessions(const User *user)
+{
+    sessions.closeAll(user);
+}
+
+// Why the session may not run the command, or empty if it may: librarians run any
+// command, and students and faculty only their own borrows, returns and reservations
+string sessionDenial(const Session &session, const vector<string> &words)
+{
+    const string &op = words[0];
+    if (session.role == Role::LIBRARIAN)
+        return "";
+    if (op == "adduser" || op == "addbook" || op == "deluser" || op == "delbook")
+        return "Only librarians can " + op + ".";
+    if (words.size() > 1 && words[1] != session.user->UniqueId)
+        return "Logged in as " + session.user->UniqueId + "; cannot act for " + words[1] + ".";
+    return "";
+}
+
+// Runs one batch command; the caller reports the result. `session` is the token the
+// script or connection is logged in with, if any; login, resume and logout change it.
+// Without a session every command is allowed, as on a librarian's own desk; only local
+// batch scripts run that way, as runLockedCommand() refuses server connections that have
+// not logged in.
+OpResult runCommand(const vector<string> &words, string &session)
+{
+    const string &op = words[0];
+    auto expect = [&](size_t count, const string &usage) {
+        return words.size() == count + 1 ? string() : "Usage: " + op + " " + usage;
+    };
+
+    if (op == "login")
+    {
+        string usage = expect(2, "<user> <password>");
+        if (!usage.empty())
+            return failed(usage);
+        const UserEntry *entry = library.findEntry(words[1]);
+        if (!checkLogin(entry, words[2]))
+            return failed("Invalid ID or password.");
+        session = sessions.open(entry->user, entry->role);
+        OpResult result;
+        result.ok = true;
+        result.id = session;
+        result.message = "Logged in as " + words[1] + ".";
+        return result;
+    }
+    if (op == "resume" || op == "logout")
+    {
+        string usage = op == "resume" ? expect(1, "<token>") : expect(0, "");
+        if (!usage.empty())
+            return failed(usage);
+        const string &token = op == "resume" ? words[1] : session;
+        Session found;
+        if (!sessions.find(token, found))
+            return failed(token.empty() ? "Not logged in." : "Unknown or expired session.");
+        OpResult result;
+        result.ok = true;
+        result.id = found.user->UniqueId;
+        if (op == "resume")
+        {
+            session = token;
+            result.message = "Resumed the session of " + result.id + ".";
+        }
+        else
+        {
+            sessions.close(token);
+            session.clear();
+            result.message = "Logged out " + result.id + ".";
+        }
+        return result;
+    }
+    if (!session.empty())
+    {
+        Session current;
+        if (!sessions.find(session, current))
+        {
+            session.clear();
+            return failed("The session has ended. Log in again.");
+        }
+        string denial = sessionDenial(current, words);
+        if (!denial.empty())
+            return failed(denial);
+    }
+
+    if (op == "borrow" || op == "reserve" || op == "return")
     {
-    case 1:
+        string usage = expect(3, "<user> <book> <ddmmyyyy>");
+        if (!usage.empty())
+            return failed(usage);
+        User *user = findUser(words[1]);
+        if (!user)
+            return failed("User with ID " + words[1] + " not found.");
+        Date date;
+        if (words[3] == "N/A" || !Date::parse(words[3], date))
+            return failed("Invalid date format. Use ddmmyyyy.");
+
+        if (op == "borrow")
+            return checkoutBook(user, words[2], date);
+        if (op == "reserve")
+            return reserveBook(user, words[2], date);
+
+        Booking *booking = user->account.findCurrent(words[2], BookingType::DIRECT_BORROW);
+        if (!booking)
+            return failed("User " + words[1] + " has not borrowed book " + words[2] + ".");
+        return returnBooking(user, user->account.current.find(booking->bookingId), date);
+    }
+    if (op == "cancel")
     {
-        Student *student = new Student(name, uniqueId, pass);
-        library.students[uniqueId] = student;
-        library.userTypes[uniqueId] = "student";
-        cout << "New student added. His Unique Id is " << uniqueId << "\n";
-        break;
+        string usage = expect(2, "<user> <book>");
+        if (!usage.empty())
+            return failed(usage);
+        User *user = findUser(words[1]);
+        if (!user)
+            return failed("User with ID " + words[1] + " not found.");
+        return withdrawReservation(user, words[2]);
+    }
+    if (op == "adduser")
+    {
+        string usage = expect(3, "<student|faculty> <name> <password>");
+        return usage.empty() ? registerUser(words[1], words[2], words[3]) : failed(usage);
+    }
+    if (op == "addbook")
+    {
+        string usage = expect(5, "<title> <author> <publisher> <ISBN> <year>");
+        if (!usage.empty())
+            return failed(usage);
+        int year;
+        auto [end, error] = from_chars(words[5].data(), words[5].data() + words[5].size(), year);
+        if (error != errc() || end != words[5].data() + words[5].size())
+            return failed("Invalid year: " + words[5]);
+        return registerBook(words[1], words[2], words[3], words[4], year);
+    }
+    if (op == "deluser" || op == "delbook")
+    {
+        string usage = expect(1, "<id>");
+        if (!usage.empty())
+            return failed(usage);
+        return op == "deluser" ? removeUser(words[1]) : removeBook(words[1]);
+    }
+    return failed("Unknown command.");
+}
+
+// Batch mode (--batch <script>): runs one command per line without prompts and prints
+// a tab-separated result line per command:
+//   <line> ok <command> <id> [fine=N]    followed by <line> note <text> for queue hand-offs
+//   <line> error <command> <message>
+// Blank lines and lines starting with # are skipped. Returns the process exit code.
+int runBatch(const string &path)
+{
+    ifstream script(path);
+    if (!script)
+    {
+        cerr << "Cannot open batch script " << path << "\n";
+        return 2;
+    }
+
+    auto start = chrono::steady_clock::now();
+    size_t lineNumber = 0, succeeded = 0, failures = 0;
+    string line, output, session;
+    while (getline(script, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        vector<string> words = splitCommand(line);
+        if (words.empty() || words[0][0] == '#')
+            continue;
+
+        OpResult result = runCommand(words, session);
+        string prefix = to_string(lineNumber) + "\t";
+        if (result.ok)
+        {
+            succeeded++;
+            output += prefix + "ok\t" + words[0] + "\t" + result.id;
+            if (result.fine > 0)
+                output += "\tfine=" + to_string(result.fine);
+            output += "\n";
+            for (const string &note : result.notes)
+                output += prefix + "note\t" + note + "\n";
+        }
+        else
+        {
+            failures++;
+            output += prefix + "error\t" + words[0] + "\t" + result.message + "\n";
+        }
+
+        if (output.size() >= 1 << 16)
+        {
+            cout << output;
+            output.clear();
+        }
+    }
+    cout << output;
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t total = succeeded + failures;
+    cout << "# " << total << " operations (" << succeeded << " ok, " << failures << " failed) in "
+         << static_cast<long long>(seconds * 1000) << " ms, "
+         << static_cast<long long>(seconds > 0 ? total / seconds : total) << " ops/s" << endl;
+    return failures ? 1 : 0;
+}
+
+// Drop-box mode (--drop-box <file>): returns many books in one pass. Each line is
+// `<user> <book> <ddmmyyyy>`, and the output is the same as for batch `return` lines:
+//   <line> ok return <booking> [fine=N]    followed by <line> note <text> for hand-offs
+//   <line> error return <message>
+// Blank lines and lines starting with # are skipped. Returns the process exit code.
+int runDropBox(const string &path)
+{
+    ifstream input(path);
+    if (!input)
+    {
+        cerr << "Cannot open drop-box file " << path << "\n";
+        return 2;
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<ReturnEvent> events;
+    vector<size_t> eventLines;
+    map<size_t, string> lineErrors; // Lines rejected before the pass
+    size_t lineNumber = 0;
+    string line;
+    while (getline(input, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        vector<string> words = splitCommand(line);
+        if (words.empty() || words[0][0] == '#')
+            continue;
+        Date date;
+        if (words.size() != 3)
+            lineErrors[lineNumber] = "Usage: <user> <book> <ddmmyyyy>";
+        else if (words[2] == "N/A" || !Date::parse(words[2], date))
+            lineErrors[lineNumber] = "Invalid date format. Use ddmmyyyy.";
+        else
+        {
+            events.push_back({words[0], words[1], date});
+            eventLines.push_back(lineNumber);
+        }
+    }
+
+    size_t groupCount = 0;
+    vector<OpResult> results = reservations.processReturns(events, groupCount);
+
+    size_t succeeded = 0, failures = lineErrors.size();
+    string output;
+    auto rejected = lineErrors.begin();
+    for (size_t i = 0; i <= events.size(); i++)
+    {
+        size_t next = i < events.size() ? eventLines[i] : SIZE_MAX;
+        for (; rejected != lineErrors.end() && rejected->first < next; ++rejected)
+            output += to_string(rejected->first) + "\terror\treturn\t" + rejected->second + "\n";
+        if (i == events.size())
+            break;
+
+        const OpResult &result = results[i];
+        string prefix = to_string(next) + "\t";
+        if (result.ok)
+        {
+            succeeded++;
+            output += prefix + "ok\treturn\t" + result.id;
+            if (result.fine > 0)
+                output += "\tfine=" + to_string(result.fine);
+            output += "\n";
+            for (const string &note : result.notes)
+                output += prefix + "note\t" + note + "\n";
+        }
+        else
+        {
+            failures++;
+            output += prefix + "error\treturn\t" + result.message + "\n";
+        }
+    }
+    cout << output;
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t total = succeeded + failures;
+    cout << "# " << total << " returns (" << succeeded << " ok, " << failures << " failed) in "
+         << static_cast<long long>(seconds * 1000) << " ms, "
+         << static_cast<long long>(seconds > 0 ? total / seconds : total) << " returns/s, "
+         << groupCount << " independent groups\n";
+    cout << "# " << reservations.assignments() << " reservations converted, " << reservations.drops()
+         << " dropped, " << reservations.releases() << " books made available; "
+         << reservations.eligibilityChecks() << " eligibility checks (" << reservations.cachedEligibilityChecks()
+         << " cached)" << endl;
+    return failures ? 1 : 0;
+}
+
+// Locking for server mode (--serve). Adding or deleting users and books takes
+// `structure` exclusively; every other command holds it shared and locks only the
+// stripes of the books and users it touches, always in ascending stripe order, so
+// commands on different books and users run in parallel without deadlocking.
+class LockTable
+{
+    static const size_t stripeCount = 1024;
+    mutex stripes[stripeCount];
+
+public:
+    shared_mutex structure;
+
+    // Locks the stripes of `ids` (each once) and returns them for unlock()
+    vector<size_t> lock(const vector<string> &ids)
+    {
+        vector<size_t> held;
+        for (const string &id : ids)
+            held.push_back(hash<string>()(id) % stripeCount);
+        sort(held.begin(), held.end());
+        held.erase(unique(held.begin(), held.end()), held.end());
+        for (size_t stripe : held)
+            stripes[stripe].lock();
+        return held;
+    }
+
+    void unlock(const vector<size_t> &held)
+    {
+        for (auto it = held.rbegin(); it != held.rend(); ++it)
+            stripes[*it].unlock();
+    }
+};
+
+LockTable lockTable;
+
+class StripeGuard
+{
+    vector<size_t> held;
+
+public:
+    explicit StripeGuard(const vector<string> &ids) : held(lockTable.lock(ids)) {}
+    ~StripeGuard() { lockTable.unlock(held); }
+    StripeGuard(const StripeGuard &) = delete;
+    StripeGuard &operator=(const StripeGuard &) = delete;
+};
+
+// Runs one command under the locks of everything it can touch. Server connections have
+// no librarian's desk behind them, so until the connection logs in (and again after it
+// logs out) only login, resume and logout are accepted.
+OpResult runLockedCommand(const vector<string> &words, string &session)
+{
+    const string &op = words[0];
+    if (session.empty() && op != "login" && op != "resume" && op != "logout")
+        return failed("Not logged in. Use login <user> <password> or resume <token> first.");
+    if (op == "adduser" || op == "addbook" || op == "deluser" || op == "delbook")
+    {
+        unique_lock<shared_mutex> exclusive(lockTable.structure);
+        return runCommand(words, session);
+    }
+
+    shared_lock<shared_mutex> shared(lockTable.structure);
+    if (op == "login" && words.size() == 3)
+    {
+        StripeGuard guard({words[1]}); // A login may rehash the user's password
+        return runCommand(words, session);
+    }
+    if (words.size() < 3)
+        return runCommand(words, session); // Resume, logout or a usage error; no book or user is touched
+    const string &userId = words[1], &bookId = words[2];
+    if (op != "return")
+    {
+        StripeGuard guard({userId, bookId});
+        return runCommand(words, session);
+    }
+
+    // A return may hand the book to anyone in its queue, so their accounts are locked too.
+    // The queue is read first; if it gained a user before everything was locked, retry.
+    while (true)
+    {
+        vector<string> ids = {userId, bookId};
+        {
+            StripeGuard bookGuard({bookId});
+            if (Book *book = library.books.find(bookId))
+                for (const string &queued : book->reservationQueue)
+                    ids.push_back(queued);
+        }
+
+        StripeGuard guard(ids);
+        bool covered = true;
+        if (Book *book = library.books.find(bookId))
+            for (const string &queued : book->reservationQueue)
+                covered = covered && find(ids.begin() + 2, ids.end(), queued) != ids.end();
+        if (covered)
+            return runCommand(words, session);
+    }
+}
+
+// Server mode: set when SIGINT or SIGTERM asks the server to stop
+atomic<bool> stopServer{false};
+
+void requestServerStop(int)
+{
+    stopServer = true;
+}
+
+bool sendAll(int fd, const string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t count = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0)
+            return false;
+        sent += count;
+    }
+    return true;
+}
+
+// One client connection: the batch command language, one command per line, answered
+// with one line: ok<TAB>command<TAB>id[<TAB>fine=N][<TAB>note...] or error<TAB>command<TAB>reason.
+// The connection is either idle, when the server's poll loop owns it and reads what the
+// client sends, or busy, when a worker owns it and runs the complete lines received.
+struct Connection
+{
+    int fd = -1;
+    string buffer;  // Received text not run yet; may end with a partial line
+    string session; // Session token once the connection has logged in
+    bool busy = false;
+    bool closing = false; // The client quit, hung up or stopped reading replies
+};
+
+// Runs the complete lines buffered on a connection and sends their replies
+void serveCommands(Connection &connection)
+{
+    Journal::deferDurability = true;
+    size_t newline;
+    string replies;
+    while (!connection.closing && (newline = connection.buffer.find('\n')) != string::npos)
+    {
+        string line = connection.buffer.substr(0, newline);
+        connection.buffer.erase(0, newline + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        vector<string> words = splitCommand(line);
+        if (words.empty() || words[0][0] == '#')
+            continue;
+        if (words[0] == "quit")
+        {
+            connection.closing = true;
+            break;
+        }
+
+        OpResult result = runLockedCommand(words, connection.session);
+        if (result.ok)
+        {
+            replies += "ok\t" + words[0] + "\t" + result.id;
+            if (result.fine > 0)
+                replies += "\tfine=" + to_string(result.fine);
+            for (const string &note : result.notes)
+                replies += "\t" + note;
+        }
+        else
+        {
+            replies += "error\t" + words[0] + "\t" + result.message;
+        }
+        replies += "\n";
+
+        // Compact between commands, once no session is inside one
+        if (journal.needsCompaction())
+        {
+            unique_lock<shared_mutex> exclusive(lockTable.structure);
+            if (journal.needsCompaction())
+                compactJournal();
+        }
+    }
+    journal.awaitDurable(); // Replies only go out once their commits are durable
+    if (!replies.empty() && !sendAll(connection.fd, replies))
+        connection.closing = true;
+}
+
+// Serves sessions on a Unix domain socket until SIGINT or SIGTERM. The main thread polls
+// the listener and every idle connection; a connection with complete lines is queued
+// for one of `workerCount` threads, which runs them and hands it back. Idle clients hold
+// no worker, so any number of desks can stay connected. The socket is only accessible
+// to the user running the server. Returns the process exit code.
+int runServer(const string &socketPath, size_t workerCount)
+{
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || socketPath.size() >= sizeof(address.sun_path))
+    {
+        cerr << "Error: Could not create socket " << socketPath << "\n";
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+    unlink(socketPath.c_str());
+    mode_t previousMask = umask(0177); // The socket is created with mode 0600
+    bool bound = bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    umask(previousMask);
+    if (!bound || listen(listener, 128) != 0)
+    {
+        cerr << "Error: Could not listen on " << socketPath << "\n";
+        close(listener);
+        return 1;
+    }
+
+    // Workers write a byte here when they hand a connection back, to wake the poll loop
+    int wakeup[2];
+    if (pipe(wakeup) != 0)
+    {
+        cerr << "Error: Could not create the wakeup pipe\n";
+        close(listener);
+        return 1;
+    }
+
+    signal(SIGINT, requestServerStop);
+    signal(SIGTERM, requestServerStop);
+    compactOnCommit = false;
+
+    // Connections with commands to run wait in `ready`; workers put them in `done`
+    queue<Connection *> ready, done;
+    mutex queueLock;
+    condition_variable connectionReady;
+    vector<thread> workers;
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back([&]() {
+            while (true)
+            {
+                unique_lock<mutex> guard(queueLock);
+                connectionReady.wait_for(guard, chrono::milliseconds(200), [&]() { return !ready.empty(); });
+                if (ready.empty())
+                {
+                    if (stopServer)
+                        return;
+                    continue;
+                }
+                Connection *connection = ready.front();
+                ready.pop();
+                guard.unlock();
+
+                serveCommands(*connection);
+
+                guard.lock();
+                done.push(connection);
+                guard.unlock();
+                char byte = 0;
+                if (write(wakeup[1], &byte, 1) < 0)
+                    cerr << "Error: Could not wake the server\n";
+            }
+        });
+    }
+
+    cout << "Serving on " << socketPath << " with " << workerCount << " worker threads" << endl;
+    map<int, unique_ptr<Connection>> connections; // Owned by this thread
+    vector<pollfd> polled;
+    char chunk[4096];
+    while (!stopServer)
+    {
+        polled.assign({{listener, POLLIN, 0}, {wakeup[0], POLLIN, 0}});
+        for (auto &entry : connections)
+            if (!entry.second->busy)
+                polled.push_back({entry.first, POLLIN, 0});
+        if (poll(polled.data(), polled.size(), 200) <= 0)
+            continue;
+
+        if (polled[1].revents & POLLIN)
+        {
+            if (read(wakeup[0], chunk, sizeof(chunk)) < 0)
+                cerr << "Error: Could not read the wakeup pipe\n";
+            lock_guard<mutex> guard(queueLock);
+            for (; !done.empty(); done.pop())
+            {
+                Connection *connection = done.front();
+                connection->busy = false;
+                if (connection->closing)
+                {
+                    close(connection->fd);
+                    connections.erase(connection->fd);
+                }
+            }
+        }
+
+        vector<Connection *> readable;
+        for (size_t i = 2; i < polled.size(); i++)
+        {
+            if (!polled[i].revents)
+                continue;
+            Connection *connection = connections[polled[i].fd].get();
+            ssize_t count = recv(connection->fd, chunk, sizeof(chunk), 0);
+            if (count <= 0)
+            {
+                close(connection->fd);
+                connections.erase(connection->fd);
+                continue;
+            }
+            connection->buffer.append(chunk, count);
+            if (connection->buffer.find('\n') != string::npos)
+                readable.push_back(connection);
+        }
+        if (!readable.empty())
+        {
+            lock_guard<mutex> guard(queueLock);
+            for (Connection *connection : readable)
+            {
+                connection->busy = true;
+                ready.push(connection);
+                connectionReady.notify_one();
+            }
+        }
+
+        if (polled[0].revents & POLLIN)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                auto connection = make_unique<Connection>();
+                connection->fd = fd;
+                connections.emplace(fd, move(connection));
+            }
+        }
+    }
+
+    for (thread &worker : workers)
+        worker.join();
+    for (auto &entry : connections)
+        close(entry.first);
+    close(wakeup[0]);
+    close(wakeup[1]);
+    close(listener);
+    unlink(socketPath.c_str());
+    printMemoryReport(cout);
+    cout << "Journal: " << journal.commitCount() << " commits, " << journal.syncCount() << " syncs\n";
+    cout << "Server stopped" << endl;
+    return 0;
+}
+
+// Bulk import (--import-books / --import-users <file>) of a CSV or TSV feed with one
+// record per line and an optional header row. Books are Title,Author,Publisher,ISBN,Year;
+// users are Name,Password,Type (student or faculty). Rows are validated in parallel, IDs
+// are allocated as one block per kind and the accepted rows are inserted in one pass.
+// Rejected rows are written to <file>.rejects with the reason.
+enum class ImportKind
+{
+    BOOKS,
+    USERS
+};
+
+struct ImportRow
+{
+    size_t lineNumber;
+    string_view line;
+    string_view fields[5];
+    string error;      // Empty when the row is accepted
+    string credential; // Users: the hashed password, computed by the validating thread
+};
+
+string_view trimField(string_view field)
+{
+    while (!field.empty() && isspace(static_cast<unsigned char>(field.front())))
+        field.remove_prefix(1);
+    while (!field.empty() && isspace(static_cast<unsigned char>(field.back())))
+        field.remove_suffix(1);
+    return field;
+}
+
+// ISBN-10 or ISBN-13, hyphens allowed; an ISBN-10 may end in X
+bool validISBN(string_view ISBN)
+{
+    size_t digits = 0;
+    for (size_t i = 0; i < ISBN.size(); i++)
+    {
+        char c = ISBN[i];
+        if (c >= '0' && c <= '9')
+            digits++;
+        else if ((c == 'X' || c == 'x') && i + 1 == ISBN.size() && digits == 9)
+            digits++;
+        else if (c != '-')
+            return false;
+    }
+    return digits == 10 || digits == 13;
+}
+
+void validateImportRow(ImportKind kind, char separator, ImportRow &row)
+{
+    size_t expected = kind == ImportKind::BOOKS ? 5 : 3;
+    string_view rest = row.line;
+    size_t count = 0;
+    while (count < expected && !rest.empty())
+        row.fields[count++] = trimField(nextField(rest, separator));
+    if (count != expected || !rest.empty())
+    {
+        row.error = "Expected " + to_string(expected) + " fields";
+        return;
+    }
+
+    // library_data.csv has no quoting, so its separators cannot appear inside a field
+    for (size_t i = 0; i < expected; i++)
+    {
+        if (row.fields[i].find_first_of(",;") != string_view::npos)
+        {
+            row.error = "Field " + to_string(i + 1) + " contains ',' or ';'";
+            return;
+        }
     }
-    case 2:
+
+    if (kind == ImportKind::BOOKS)
+    {
+        int year = 0;
+        string_view yearText = row.fields[4];
+        auto [end, error] = from_chars(yearText.data(), yearText.data() + yearText.size(), year);
+        if (row.fields[0].empty())
+            row.error = "Missing title";
+        else if (!validISBN(row.fields[3]))
+            row.error = "Invalid ISBN";
+        else if (error != errc() || end != yearText.data() + yearText.size() || year < 1 || year > 9999)
+            row.error = "Invalid year";
+    }
+    else
+    {
+        if (row.fields[0].empty())
+            row.error = "Missing name";
+        else if (row.fields[0].find(' ') != string_view::npos)
+            row.error = "Names cannot contain spaces"; // The login prompt reads one word
+        else if (row.fields[1].empty())
+            row.error = "Missing password";
+        else if (row.fields[2] != "student" && row.fields[2] != "faculty")
+            row.error = "Type must be student or faculty";
+        else
+            row.credential = hashPassword(string(row.fields[1]));
+    }
+}
+
+bool importHeader(ImportKind kind, string_view line)
+{
+    string first;
+    for (char c : line.substr(0, line.find_first_of(",\t")))
+        first += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return first == (kind == ImportKind::BOOKS ? "title" : "name");
+}
+
+// Imports the feed into the global library; returns false if it cannot be read. The
+// search index is left alone: the import runs on its own and the next start indexes it.
+bool importFile(ImportKind kind, const string &path)
+{
+    auto startTime = chrono::steady_clock::now();
+
+    MappedFile file(path);
+    if (!file.isOpen())
+    {
+        cerr << "Error: Could not open " << path << "\n";
+        return false;
+    }
+
+    // Split the feed into lines; the first line decides between tabs and commas
+    vector<ImportRow> rows;
+    string_view rest = file.view();
+    char separator = rest.substr(0, rest.find('\n')).find('\t') != string_view::npos ? '\t' : ',';
+    size_t lineNumber = 0;
+    while (!rest.empty())
+    {
+        string_view line = nextField(rest, '\n');
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty() || (rows.empty() && importHeader(kind, line)))
+            continue;
+        rows.push_back(ImportRow{lineNumber, line, {}, "", ""});
+    }
+
+    // Validate contiguous chunks of rows on all cores; hashing passwords makes user rows
+    // far slower than book rows, so they are split up sooner
+    size_t rowsPerThread = kind == ImportKind::BOOKS ? 4096 : 16;
+    size_t threadCount = min<size_t>(max(1u, thread::hardware_concurrency()), rows.size() / rowsPerThread + 1);
+    vector<thread> workers;
+    size_t chunk = (rows.size() + threadCount - 1) / threadCount;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        size_t begin = t * chunk, end = min(rows.size(), begin + chunk);
+        workers.emplace_back([&rows, kind, separator, begin, end]() {
+            for (size_t i = begin; i < end; i++)
+                validateImportRow(kind, separator, rows[i]);
+        });
+    }
+    for (thread &worker : workers)
+        worker.join();
+
+    // Allocate the IDs of each kind as one block, in file order
+    size_t counts[2] = {0, 0}; // Books or students, then faculty
+    for (const ImportRow &row : rows)
+        if (row.error.empty())
+            counts[kind == ImportKind::USERS && row.fields[2] == "faculty"]++;
+    IdKind kinds[2] = {kind == ImportKind::BOOKS ? IdKind::BOOK : IdKind::STUDENT, IdKind::FACULTY};
+    unsigned long long nextId[2] = {idAllocator.allocateBlock(kinds[0], counts[0]),
+                                    idAllocator.allocateBlock(kinds[1], counts[1])};
+    if (kind == ImportKind::BOOKS)
+        library.books.reserve(library.books.size() + counts[0]);
+    else
+        library.users.reserve(library.users.size() + counts[0] + counts[1]);
+
+    ofstream rejects;
+    size_t accepted = 0, rejected = 0;
+    for (const ImportRow &row : rows)
+    {
+        if (!row.error.empty())
+        {
+            if (!rejects.is_open())
+                rejects.open(path + ".rejects");
+            rejects << row.lineNumber << "\t" << row.error << "\t" << row.line << "\n";
+            rejected++;
+            continue;
+        }
+
+        if (kind == ImportKind::BOOKS)
+        {
+            string bookId = IdAllocator::format(IdKind::BOOK, nextId[0]++);
+            Book *book = bookPool.create(bookId, string(row.fields[0]), string(row.fields[1]), string(row.fields[2]),
+                                  string(row.fields[3]), atoi(string(row.fields[4]).c_str()));
+            library.books.insert(book);
+        }
+        else if (row.fields[2] == "faculty")
+        {
+            string userId = IdAllocator::format(IdKind::FACULTY, nextId[1]++);
+            createUser(Role::FACULTY, string(row.fields[0]), userId, row.credential);
+        }
+        else
+        {
+            string userId = IdAllocator::format(IdKind::STUDENT, nextId[0]++);
+            createUser(Role::STUDENT, string(row.fields[0]), userId, row.credential);
+        }
+        accepted++;
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    double seconds = elapsed.count();
+    cout << "Imported " << accepted << (kind == ImportKind::BOOKS ? " books" : " users") << " from " << path
+         << " (" << rejected << " rejected";
+    if (rejected)
+        cout << ", see " << path << ".rejects";
+    cout << ") in " << static_cast<long long>(seconds * 1000) << " ms, "
+         << static_cast<long long>(seconds > 0 ? rows.size() / seconds : rows.size()) << " rows/s\n";
+    return true;
+}
+
+// Replaces every legacy plaintext password with a hash (--hash-passwords). The hashing
+// runs on all cores; the caller then compacts so no plaintext is left in the data files.
+void hashLegacyPasswords()
+{
+    auto startTime = chrono::steady_clock::now();
+    vector<const UserEntry *> legacy;
+    for (const UserEntry *entry : library.usersByRole())
+        if (!isPasswordHash(entry->user->getCredential()))
+            legacy.push_back(entry);
+
+    vector<string> credentials(legacy.size());
+    parallelFor(legacy.size(), [&](size_t i)
+                { credentials[i] = hashPassword(legacy[i]->user->getCredential()); });
+    for (size_t i = 0; i < legacy.size(); i++)
+    {
+        legacy[i]->user->setCredential(credentials[i]);
+        journal.record(JournalOp::USER, userRow(legacy[i]->user, roleName(legacy[i]->role)));
+    }
+    if (!legacy.empty())
+        commitJournal();
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    cout << "Hashed " << legacy.size() << " plaintext passwords in " << static_cast<long long>(elapsed.count() * 1000)
+         << " ms\n";
+}
+
+// Overdue notices for one borrower
+struct OverdueNotice
+{
+    User *user = nullptr;
+    vector<const Booking *> bookings = {}; // Overdue direct borrows, earliest due first
+    int fine = 0;
+    bool blocked = false;
+    string text = {};
+};
+
+// Finds every overdue direct borrow on `date` through the due date index and builds one
+// notice per borrower, sorted by user ID. Fines and notice texts are worked out in
+// parallel, a contiguous run of borrowers per thread.
+vector<OverdueNotice> scanOverdue(Date date)
+{
+    vector<OverdueNotice> notices;
+    unordered_map<const User *, size_t> noticeOf;
+    for (const Booking *booking : dueDates.overdue(date))
+    {
+        auto [it, added] = noticeOf.emplace(booking->user, notices.size());
+        if (added)
+            notices.push_back(OverdueNotice{booking->user});
+        notices[it->second].bookings.push_back(booking);
+    }
+    sort(notices.begin(), notices.end(), [](const OverdueNotice &a, const OverdueNotice &b)
+         { return a.user->UniqueId < b.user->UniqueId; });
+
+    auto build = [date](OverdueNotice &notice)
+    {
+        User *user = notice.user;
+        bool student = user->paysFines();
+        ostringstream text;
+        text << "Overdue notice for " << user->UniqueId << " (" << user->name << ", "
+             << (student ? "student" : "faculty") << ") as of " << date << "\n";
+        for (const Booking *booking : notice.bookings)
+        {
+            Date due = dueDate(booking);
+            text << "  " << booking->book->bookId << " \"" << booking->book->title << "\": borrowed "
+                 << booking->borrowDate << ", due " << due << ", " << (date - due) << " days overdue";
+            if (student)
+            {
+                int fine = calculateFine(booking->borrowDate, date);
+                notice.fine += fine;
+                text << ", fine " << fine << " rupees";
+            }
+            text << "\n";
+        }
+        if (student)
+        {
+            text << "  Total fine: " << notice.fine << " rupees. Borrowing is blocked until it is paid.\n";
+            notice.blocked = notice.fine > 0;
+        }
+        else
+        {
+            // A faculty borrow is overdue exactly when it blocks borrowing
+            text << "  Borrowing is blocked: a book has been out for more than " << Faculty::blockDays
+                 << " days.\n";
+            notice.blocked = true;
+        }
+        notice.text = text.str();
+    };
+
+    size_t threadCount = min<size_t>(max(1u, thread::hardware_concurrency()), (notices.size() + 255) / 256);
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount; t++)
     {
-        Faculty *faculty = new Faculty(name, uniqueId, pass);
-        library.faculties[uniqueId] = faculty;
-        library.userTypes[uniqueId] = "faculty";
-        cout << "New faculty added. His Unique Id is " << uniqueId << "\n";
-        break;
-    }
+        size_t begin = notices.size() * t / threadCount;
+        size_t end = notices.size() * (t + 1) / threadCount;
+        workers.emplace_back([&notices, &build, begin, end]()
+                             {
+            for (size_t i = begin; i < end; i++)
+                build(notices[i]); });
     }
+    for (thread &worker : workers)
+        worker.join();
+    return notices;
 }
 
-void Librarian::addNewBook()
+// Overdue run (--overdue <ddmmyyyy> [--notices <file>]): writes the notices to the file,
+// or to standard output, and a summary line. Returns the process exit code.
+int runOverdue(const string &dateText, const string &noticesPath)
 {
-    string bookId = generateUniqueId();
-    string title, author, publisher, ISBN;
-    int year;
-
-    cout << "Enter book title: ";
-    cin.ignore();
-    getline(cin, title);
-
-    cout << "Enter book author: ";
-    getline(cin, author);
-
-    cout << "Enter book publisher: ";
-    getline(cin, publisher);
+    Date date;
+    if (dateText == "N/A" || !Date::parse(dateText, date))
+    {
+        cerr << "Invalid date format. Use ddmmyyyy.\n";
+        return 2;
+    }
 
-    cout << "Enter book ISBN: ";
-    cin >> ISBN;
+    auto startTime = chrono::steady_clock::now();
+    vector<OverdueNotice> notices = scanOverdue(date);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
 
-    cout << "Enter book year: ";
-    cin >> year;
+    ofstream file;
+    if (!noticesPath.empty())
+    {
+        file.open(noticesPath);
+        if (!file)
+        {
+            cerr << "Error: Could not write " << noticesPath << "\n";
+            return 1;
+        }
+    }
+    ostream &out = noticesPath.empty() ? cout : file;
 
-    library.books[bookId] = new Book(bookId, title, author, publisher, ISBN, year);
-    cout << "Book added successfully. ID: " << bookId << endl;
+    size_t bookings = 0, blocked = 0;
+    long long fines = 0;
+    for (const OverdueNotice &notice : notices)
+    {
+        out << notice.text << "\n";
+        bookings += notice.bookings.size();
+        blocked += notice.blocked;
+        fines += notice.fine;
+    }
+    cout << "Overdue on " << date << ": " << bookings << " bookings for " << notices.size() << " users ("
+         << blocked << " blocked), fines totalling " << fines << " rupees. Scanned in " << fixed
+         << setprecision(2) << elapsed.count() * 1000 << " ms.\n";
+    cout.unsetf(ios::fixed);
+    return 0;
 }
 
-void Librarian::listUsers()
+// History analytics (--history-report): totals the returned loans in the history store by
+// book, user, role, month or year. Books and users are ranked by loans and cut to
+// `--limit`; the other groups are listed in order.
+int runHistoryReport(const vector<string> &args)
 {
-    cout << "List of all users:\n";
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-    cout << "Type      | ID    | Name\n";
-    cout << "--------------------------------------------------------------------------------------------------------\n";
-
-    for (auto &studentPair : library.students)
+    static const pair<const char *, HistoryGroup> groupNames[] = {
+        {"books", HistoryGroup::BOOK}, {"users", HistoryGroup::USER}, {"roles", HistoryGroup::ROLE},
+        {"months", HistoryGroup::MONTH}, {"years", HistoryGroup::YEAR}};
+
+    HistoryGroup group = HistoryGroup::BOOK;
+    bool known = false;
+    for (const auto &name : groupNames)
+        if (!args.empty() && args[0] == name.first)
+        {
+            group = name.second;
+            known = true;
+        }
+    if (!known)
     {
-        Student *student = studentPair.second;
-        cout << "Student   | " << student->UniqueId << " | " << student->name << endl;
+        cerr << "Unknown report. Use books, users, roles, months or years.\n";
+        return 2;
     }
 
-    for (auto &facultyPair : library.faculties)
+    HistoryFilter filter;
+    size_t limit = 100;
+    for (size_t i = 1; i + 1 < args.size(); i += 2)
     {
-        Faculty *faculty = facultyPair.second;
-        cout << "Faculty   | " << faculty->UniqueId << " | " << faculty->name << endl;
+        const string &option = args[i], &value = args[i + 1];
+        Date date;
+        if ((option == "--from" || option == "--to") && (value == "N/A" || !Date::parse(value, date)))
+        {
+            cerr << "Invalid date format. Use ddmmyyyy.\n";
+            return 2;
+        }
+        if (option == "--from")
+            filter.from = date;
+        else if (option == "--to")
+            filter.to = date + 1; // The end date is included
+        else if (option == "--by")
+            filter.byReturnDate = value == "return";
+        else if (option == "--role")
+        {
+            filter.anyRole = !parseRole(value, filter.role);
+            if (filter.anyRole)
+            {
+                cerr << "Invalid role. Use student or faculty.\n";
+                return 2;
+            }
+        }
+        else if (option == "--limit")
+            limit = max(1, atoi(value.c_str()));
     }
 
-    cout << "--------------------------------------------------------------------------------------------------------\n";
+    auto startTime = chrono::steady_clock::now();
+    bool ranked = group == HistoryGroup::BOOK || group == HistoryGroup::USER;
+    vector<HistoryAggregate> groups = ranked ? historyStore.top(filter, group, limit) : historyStore.aggregate(filter, group);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    long long loans = 0, fines = 0;
+    static const char *headings[] = {"Book", "User", "Role", "Month", "Year"};
+    cout << left << setw(12) << headings[static_cast<int>(group)];
+    if (group == HistoryGroup::BOOK)
+        cout << setw(32) << "Title";
+    cout << right << setw(10) << "Loans" << setw(10) << "Avg days" << setw(12) << "Fines" << "\n";
+    for (const HistoryAggregate &total : groups)
+    {
+        cout << left << setw(12) << total.label;
+        if (group == HistoryGroup::BOOK)
+            cout << setw(32) << total.title.substr(0, 31);
+        cout << right << setw(10) << total.loans << setw(10) << fixed << setprecision(1)
+             << static_cast<double>(total.loanDays) / total.loans << setw(12) << total.fines << "\n";
+        loans += total.loans;
+        fines += total.fines;
+    }
+    cout << left << groups.size() << " groups, " << loans << " loans, fines totalling " << fines
+         << " rupees (" << historyStore.size() << " loans in history, queried in " << setprecision(2)
+         << elapsed.count() * 1000 << " ms).\n";
+    cout.unsetf(ios::fixed);
+    return 0;
 }
 
-void Librarian::login()
+// Login microbenchmark: --bench-logins [--users N] [--logins N] [--iterations N] builds
+// users with hashed passwords and times full password logins against session resumes,
+// on one thread and then on every core
+void runLoginBenchmark(size_t userCount, size_t loginCount, unsigned iterations)
 {
-    cout << "Librarian logged in successfully. Welcome, " << name << "!\n";
+    const size_t resumeCount = 1000000;
+    size_t cores = max(1u, thread::hardware_concurrency());
 
-    while (true)
+    auto start = chrono::steady_clock::now();
+    vector<string> credentials(userCount);
+    parallelFor(userCount, [&](size_t i)
+                { credentials[i] = hashPassword("pw" + to_string(i), iterations); });
+    chrono::duration<double> hashTime = chrono::steady_clock::now() - start;
+
+    vector<string> userIds, tokens;
+    for (size_t i = 0; i < userCount; i++)
     {
-        cout << "\nWhat would you like to do?\n";
-        cout << "1. Add New User\n";
-        cout << "2. Add New Book\n";
-        cout << "3. List Users\n";
-        cout << "4. List Books in Library\n";
-        cout << "5. Delete User\n";
-        cout << "6. Delete Book\n";
-        cout << "7. Log Out\n";
-        cout << "Enter your choice: ";
+        userIds.push_back(IdAllocator::format(IdKind::STUDENT, 1000 + i));
+        User *user = createUser(Role::STUDENT, "User" + to_string(i), userIds.back(), credentials[i]);
+        tokens.push_back(sessions.open(user, Role::STUDENT));
+    }
 
-        int choice;
-        cin >> choice;
+    cout << "Login benchmark: " << userCount << " users, PBKDF2-HMAC-SHA256 with " << iterations
+         << " iterations (hashed in " << fixed << setprecision(1) << hashTime.count() * 1000 << " ms)\n";
+    cout << left << setw(16) << "Login" << right << setw(10) << "Threads" << setw(14) << "Logins/s" << "\n";
 
-        switch (choice)
-        {
-        case 1:
-            addNewUser();
-            break;
-        case 2:
-            addNewBook();
-            break;
-        case 3:
-            listUsers();
-            break;
-        case 4:
-            list_books();
-            break;
-        case 5:
-            deleteUser();
-            break;
-        case 6:
-            deleteBook();
+    // Runs `count` logins split between `threads` workers and returns the rate. Each worker
+    // keeps its own session, as a connection would.
+    atomic<size_t> failures{0};
+    auto rate = [&](size_t count, size_t threads, bool resume)
+    {
+        auto begin = chrono::steady_clock::now();
+        parallelFor(threads, [&](size_t t)
+                    {
+            string session;
+            for (size_t k = t; k < count; k += threads)
+            {
+                size_t i = k * 7919 % userCount;
+                vector<string> words = resume ? vector<string>{"resume", tokens[i]}
+                                              : vector<string>{"login", userIds[i], "pw" + to_string(i)};
+                if (!runCommand(words, session).ok)
+                    failures++;
+            } });
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+        return count / elapsed.count();
+    };
+    for (size_t threads : {size_t(1), cores})
+    {
+        cout << left << setw(16) << "password" << right << setw(10) << threads << setw(14) << setprecision(0)
+             << rate(loginCount, threads, false) << "\n";
+        cout << left << setw(16) << "session token" << right << setw(10) << threads << setw(14)
+             << rate(resumeCount, threads, true) << "\n";
+        if (cores == 1)
             break;
-        case 7:
-            cout << "Logging out...\n";
-            return;
-        default:
-            cout << "Invalid choice. Please try again.\n";
-        }
     }
+    if (failures > 0)
+        cout << failures << " logins failed\n";
+    cout.unsetf(ios::fixed);
 }
 
-void Librarian::deleteUser()
+// Catalog microbenchmark: --bench-catalog [N ...] times ID lookups in BookCatalog against
+// the map<string, Book *> it replaced, for catalogs of 10k, 1M and 10M books by default.
+// Each size is built from scratch in bookPool and runs the same random hits and misses.
+void runCatalogBenchmark(const vector<size_t> &sizes)
 {
-    cout << "Enter the ID of the user to delete: ";
-    string userId;
-    cin >> userId;
+    const size_t lookups = 1000000;
+    mt19937_64 random(42);
 
-    // Check if the user is a student
-    if (library.students.count(userId))
+    cout << "Catalog lookups (" << lookups << " hits and " << lookups << " misses per size)\n";
+    cout << right << setw(10) << "Books" << setw(10) << "Index" << setw(12) << "Build ms" << setw(14)
+         << "Hits/s" << setw(14) << "Misses/s" << "\n";
+
+    for (size_t n : sizes)
     {
-        Student *student = library.students[userId];
-        if (student->account.current.empty())
+        vector<Book *> books;
+        books.reserve(n);
+        for (size_t i = 0; i < n; i++)
         {
-            library.students.erase(userId);
-            library.userTypes.erase(userId);
-            cout << "Student with ID " << userId << " deleted successfully.\n";
+            Book *book = bookPool.create();
+            book->bookId = IdAllocator::format(IdKind::BOOK, 1000 + i);
+            books.push_back(book);
         }
-        else
+        vector<string> hits, misses;
+        hits.reserve(lookups);
+        misses.reserve(lookups);
+        for (size_t i = 0; i < lookups; i++)
         {
-            cout << "Cannot delete student. They have active bookings.\n";
+            hits.push_back(books[random() % n]->bookId);
+            misses.push_back(IdAllocator::format(IdKind::BOOK, 1000 + n + random() % n));
         }
-    }
-    // Check if the user is a faculty
-    else if (library.faculties.count(userId))
-    {
-        Faculty *faculty = library.faculties[userId];
-        if (faculty->account.current.empty())
+
+        // Runs every query through `find` and returns the rate; `found` keeps the work observable
+        size_t found = 0;
+        auto rate = [&](const vector<string> &queries, auto find)
+        {
+            auto start = chrono::steady_clock::now();
+            for (const string &query : queries)
+                found += find(query) != nullptr;
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            return queries.size() / elapsed.count();
+        };
+        auto printRow = [&](const char *index, double buildSeconds, double hitRate, double missRate)
         {
-            library.faculties.erase(userId);
-            library.userTypes.erase(userId);
-            cout << "Faculty with ID " << userId << " deleted successfully.\n";
+            cout << setw(10) << n << setw(10) << index << setw(12) << fixed << setprecision(1)
+                 << buildSeconds * 1000 << setw(14) << setprecision(0) << hitRate << setw(14) << missRate
+                 << "\n";
+        };
+
+        {
+            auto start = chrono::steady_clock::now();
+            map<string, Book *> tree;
+            for (Book *book : books)
+                tree.emplace(book->bookId, book);
+            chrono::duration<double> build = chrono::steady_clock::now() - start;
+            auto find = [&](const string &bookId) -> Book *
+            {
+                auto it = tree.find(bookId);
+                return it == tree.end() ? nullptr : it->second;
+            };
+            double hitRate = rate(hits, find);
+            printRow("map", build.count(), hitRate, rate(misses, find));
         }
-        else
         {
-            cout << "Cannot delete faculty. They have active bookings.\n";
+            auto start = chrono::steady_clock::now();
+            BookCatalog catalog;
+            for (Book *book : books)
+                catalog.insert(book);
+            chrono::duration<double> build = chrono::steady_clock::now() - start;
+            auto find = [&](const string &bookId) { return catalog.find(bookId); };
+            double hitRate = rate(hits, find);
+            printRow("catalog", build.count(), hitRate, rate(misses, find));
         }
+        if (found != 2 * lookups)
+            cout << "Lookup mismatch: " << found << " books found\n";
+
+        for (Book *book : books)
+            bookPool.destroy(book);
+        trimPools();
     }
-    // Check if the user is a librarian
-    else if (library.librarians.count(userId))
+    cout.unsetf(ios::fixed);
+}
+
+// Benchmark suite (--bench): a synthetic library with Zipf-distributed book popularity and
+// a random mix of borrows, returns, reservations and searches run through the core
+// operations, followed by timed CSV save and load rounds. Nothing touches the real data
+// files: the journal stays closed and the CSV rounds use a temporary file.
+struct BenchConfig
+{
+    size_t books = 100000;
+    size_t users = 20000;   // One in five is faculty
+    size_t history = 200000; // Past bookings spread over the year before the run
+    size_t ops = 200000;
+    double zipf = 1.0;      // Popularity skew; 0 is uniform
+    size_t rounds = 3;      // CSV save and load rounds
+    unsigned long long seed = 1;
+    string jsonPath;        // Results are also written here as JSON when set
+};
+
+// Samples popularity ranks 0..n-1 with P(rank) proportional to 1 / (rank + 1)^s
+class ZipfSampler
+{
+    vector<double> cumulative;
+
+public:
+    ZipfSampler(size_t n, double s)
     {
-        cout << "Librarians cannot be deleted.\n";
+        cumulative.reserve(n);
+        double total = 0;
+        for (size_t rank = 0; rank < n; rank++)
+            cumulative.push_back(total += 1.0 / pow(rank + 1.0, s));
     }
-    // User not found
-    else
+
+    size_t operator()(mt19937_64 &random) const
     {
-        cout << "User with ID " << userId << " not found.\n";
+        double target = uniform_real_distribution<double>(0, cumulative.back())(random);
+        size_t rank = lower_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+        return min(rank, cumulative.size() - 1);
     }
-}
+};
 
-// Function to delete a book
-void Librarian::deleteBook()
+// Latencies of one kind of benchmark operation
+struct BenchOp
 {
-    cout << "Enter the ID of the book to delete: ";
-    string bookId;
-    cin >> bookId;
+    string name = {};
+    vector<double> latencies = {}; // Microseconds
+    size_t succeeded = 0;
 
-    if (library.books.count(bookId))
+    void add(double microseconds, bool ok)
     {
-        Book *book = library.books[bookId];
-        if (book->status == BookStatus::AVAILABLE && book->reservationQueue.empty())
-        {
-            library.books.erase(bookId);
-            cout << "Book with ID " << bookId << " deleted successfully.\n";
-        }
-        else
-        {
-            cout << "Cannot delete book. It is either borrowed or has reservations.\n";
-        }
+        latencies.push_back(microseconds);
+        succeeded += ok;
     }
-    else
+
+    double percentile(double p) const
+    {
+        if (latencies.empty())
+            return 0;
+        vector<double> sorted = latencies;
+        size_t index = min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+        nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+    double opsPerSecond() const
     {
-        cout << "Book with ID " << bookId << " not found.\n";
+        double total = 0;
+        for (double latency : latencies)
+            total += latency;
+        return total > 0 ? latencies.size() / (total / 1e6) : 0;
     }
+};
+
+// Frees every user, book and tombstone, leaving an empty library
+void clearLibrary()
+{
+    vector<string> userIds;
+    for (const auto &entry : library.users)
+        userIds.push_back(entry.first);
+    for (const string &userId : userIds)
+        destroyUser(userId);
+    library.books.forEach([](Book *book)
+                          { bookPool.destroy(book); });
+    library.books = BookCatalog();
+    for (const auto &bookPair : library.deletedBooks)
+        bookPool.destroy(bookPair.second);
+    library.deletedBooks.clear();
+    catalogSearch.clear();
+    historyStore.clear();
+    trimPools();
 }
 
-// Login function
-void login()
+int runBenchmark(const BenchConfig &config)
 {
-    string userType, ID, password;
+    mt19937_64 random(config.seed);
+    auto pick = [&](size_t n)
+    { return static_cast<size_t>(random() % n); };
+    compactOnCommit = false;
+
+    // Titles, authors and publishers are drawn from a made-up vocabulary so searches have
+    // realistic posting lists
+    static const char *syllables[] = {"ka", "lo", "mi", "ren", "su", "ta", "vor", "xi", "an", "del", "gro", "pha"};
+    vector<string> words(2000);
+    for (string &word : words)
+        for (int i = 0, count = 2 + pick(2); i < count; i++)
+            word += syllables[pick(size(syllables))];
+
+    auto buildStart = chrono::steady_clock::now();
+    vector<Book *> books;
+    books.reserve(config.books);
+    library.books.reserve(config.books);
+    for (size_t i = 0; i < config.books; i++)
+    {
+        string title = words[pick(words.size())] + " " + words[pick(words.size())] + " " + words[pick(words.size())];
+        string author = words[pick(words.size())] + " " + words[pick(words.size())];
+        string publisher = words[pick(words.size() / 20)] + " Press";
+        string ISBN = to_string(9780000000000ULL + i);
+        Book *book = bookPool.create(generateUniqueId(IdKind::BOOK), title, author, publisher, ISBN,
+                                     1950 + static_cast<int>(pick(75)));
+        library.books.insert(book);
+        catalogSearch.add(book);
+        books.push_back(book);
+    }
+    // Popularity follows a random permutation of the catalog, not its ID order
+    shuffle(books.begin(), books.end(), random);
+    ZipfSampler popularity(books.size(), config.zipf);
+
+    vector<User *> users;
+    users.reserve(config.users);
+    library.users.reserve(config.users);
+    string credential = hashPassword("secret"); // Shared, as hashing every user's would dominate the build
+    for (size_t i = 0; i < config.users; i++)
+    {
+        Role role = i % 5 == 4 ? Role::FACULTY : Role::STUDENT;
+        string userId = generateUniqueId(role == Role::FACULTY ? IdKind::FACULTY : IdKind::STUDENT);
+        users.push_back(createUser(role, "User" + to_string(i), userId, credential));
+    }
 
-    cout << "Enter user type (student/faculty/librarian): ";
-    cin >> userType;
+    Date today = Date::fromCivil(2024, 1, 1);
+    for (size_t i = 0; i < config.history; i++)
+    {
+        User *user = users[pick(users.size())];
+        Date borrowDate = today + -(1 + static_cast<int>(pick(365)));
+        Booking *booking = bookingPool.create(generateUniqueId(IdKind::BOOKING), books[popularity(random)], user,
+                                              borrowDate, borrowDate, borrowDate + 1 + static_cast<int>(pick(30)),
+                                              0, BookingType::DIRECT_BORROW);
+        user->account.addHistory(booking);
+    }
+    chrono::duration<double> buildTime = chrono::steady_clock::now() - buildStart;
 
-    cout << "Enter your ID: ";
-    cin >> ID;
-    cout << "Enter your password: ";
-    cin >> password;
+    cout << "Benchmark library: " << config.books << " books, " << config.users << " users, " << config.history
+         << " history bookings (built in " << fixed << setprecision(1) << buildTime.count() * 1000 << " ms)\n";
 
-    if (userType == "student")
+    // The mix: 40% borrows, 30% returns, 10% reservations, 20% searches, over one simulated year
+    BenchOp borrow{"borrow"}, giveBack{"return"}, reserve{"reserve"}, search{"search"}, save{"save"}, load{"load"};
+    size_t opsPerDay = max<size_t>(1, config.ops / 365);
+    auto mixStart = chrono::steady_clock::now();
+    for (size_t i = 0; i < config.ops; i++)
     {
-        if (library.students.count(ID) && library.students[ID]->authenticate(password))
+        if (i > 0 && i % opsPerDay == 0)
+            today = today + 1;
+        size_t roll = pick(100);
+        User *user = users[pick(users.size())];
+        auto start = chrono::steady_clock::now();
+        bool ok;
+        BenchOp *op;
+        if (roll < 40)
         {
-            library.students[ID]->login();
+            op = &borrow;
+            ok = checkoutBook(user, books[popularity(random)]->bookId, today).ok;
         }
-        else
+        else if (roll < 70)
         {
-            cout << "Invalid ID or password for student.\n";
+            // Returns go to the first of a few users who has something to give back
+            op = &giveBack;
+            for (int attempt = 0; attempt < 8 && user->account.current.empty(); attempt++)
+                user = users[pick(users.size())];
+            ok = !user->account.current.empty() &&
+                 returnBooking(user, user->account.current.begin(), today).ok;
         }
-    }
-    else if (userType == "faculty")
-    {
-        if (library.faculties.count(ID) && library.faculties[ID]->authenticate(password))
+        else if (roll < 80)
         {
-            library.faculties[ID]->login();
+            op = &reserve;
+            ok = reserveBook(user, books[popularity(random)]->bookId, today).ok;
         }
         else
         {
-            cout << "Invalid ID or password for faculty.\n";
+            op = &search;
+            SearchQuery query;
+            query.text = words[pick(words.size())];
+            ok = catalogSearch.search(query).total > 0;
         }
+        chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+        op->add(elapsed.count(), ok);
+    }
+    chrono::duration<double> mixTime = chrono::steady_clock::now() - mixStart;
+
+    // CSV rounds: save the library, then load it back into an empty one
+    const char *tempDir = getenv("TMPDIR");
+    string csvPath = string(tempDir && *tempDir ? tempDir : "/tmp") + "/lms-bench-" + to_string(getpid()) + ".csv";
+    size_t loadedBooks = library.books.size();
+    for (size_t round = 0; round < config.rounds; round++)
+    {
+        cout.setstate(ios::failbit); // Silences the save and load messages
+        auto start = chrono::steady_clock::now();
+        saveToCSV(csvPath);
+        chrono::duration<double, micro> saveTime = chrono::steady_clock::now() - start;
+        clearLibrary();
+        start = chrono::steady_clock::now();
+        loadFromCSV(csvPath);
+        chrono::duration<double, micro> loadTime = chrono::steady_clock::now() - start;
+        cout.clear();
+        save.add(saveTime.count(), true);
+        load.add(loadTime.count(), library.books.size() == loadedBooks);
     }
-    else if (userType == "librarian")
+    remove(csvPath.c_str());
+
+    vector<const BenchOp *> results = {&borrow, &giveBack, &reserve, &search, &save, &load};
+    cout << "Mix: " << config.ops << " operations in " << setprecision(1) << mixTime.count() * 1000 << " ms ("
+         << setprecision(0) << config.ops / mixTime.count() << " ops/s)\n";
+    cout << left << setw(10) << "Operation" << right << setw(10) << "Count" << setw(10) << "OK" << setw(14)
+         << "Ops/s" << setw(12) << "p50 us" << setw(12) << "p99 us" << "\n";
+    for (const BenchOp *op : results)
+        cout << left << setw(10) << op->name << right << setw(10) << op->latencies.size() << setw(10)
+             << op->succeeded << setw(14) << setprecision(0) << op->opsPerSecond() << setw(12) << setprecision(1)
+             << op->percentile(0.5) << setw(12) << op->percentile(0.99) << "\n";
+    cout.unsetf(ios::fixed);
+
+    if (!config.jsonPath.empty())
     {
-        if (library.librarians.count(ID) && library.librarians[ID]->authenticate(password))
+        ofstream json(config.jsonPath);
+        if (!json)
         {
-            library.librarians[ID]->login();
+            cerr << "Error: Could not write " << config.jsonPath << "\n";
+            return 1;
         }
-        else
+        json << fixed << setprecision(3);
+        json << "{\n  \"config\": {\"books\": " << config.books << ", \"users\": " << config.users
+             << ", \"history\": " << config.history << ", \"ops\": " << config.ops << ", \"zipf\": " << config.zipf
+             << ", \"rounds\": " << config.rounds << ", \"seed\": " << config.seed << "},\n";
+        json << "  \"buildMs\": " << buildTime.count() * 1000 << ",\n";
+        json << "  \"mixOpsPerSec\": " << config.ops / mixTime.count() << ",\n";
+        json << "  \"operations\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
         {
-            cout << "Invalid ID or password for librarian.\n";
+            const BenchOp *op = results[i];
+            json << "    {\"name\": \"" << op->name << "\", \"count\": " << op->latencies.size()
+                 << ", \"succeeded\": " << op->succeeded << ", \"opsPerSec\": " << op->opsPerSecond()
+                 << ", \"p50Us\": " << op->percentile(0.5) << ", \"p99Us\": " << op->percentile(0.99) << "}"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
         }
+        json << "  ]\n}\n";
     }
-    else
-    {
-        cout << "Invalid user type. Use 'student', 'faculty', or 'librarian'.\n";
-    }
+    return 0;
 }
 
-void saveToCSV()
+// Main function
+int main(int argc, char *argv[])
 {
-    ofstream file("library_data.csv");
-
-    // Save books
-    file << "Books\n";
-    file << "BookID,Title,Author,Publisher,ISBN,Year,Status,ReservationQueue\n";
-    for (const auto &bookPair : library.books)
-    {
-        Book *book = bookPair.second;
-        file << book->bookId << ","
-             << book->title << ","
-             << book->author << ","
-             << book->publisher << ","
-             << book->ISBN << ","
-             << book->year << ","
-             << (book->status == BookStatus::AVAILABLE ? "Available" : "Borrowed") << ",";
-        for (const string &userId : book->reservationQueue)
-        {
-            file << userId << ";";
-        }
-        file << "\n";
-    }
-
-    // Save users (using getPassword() to access protected password)
-    file << "\nUsers\n";
-    file << "UserID,Name,Password,UserType\n";
-    for (const auto &studentPair : library.students)
+    // Snapshot conversion tools: --csv-to-snapshot [in.csv] [out.snap] and --snapshot-to-csv [in.snap] [out.csv]
+    if (argc >= 2 && string(argv[1]) == "--csv-to-snapshot")
     {
-        Student *student = studentPair.second;
-        file << student->UniqueId << ","
-             << student->name << ","
-             << student->getPassword() << "," // Use getPassword()
-             << "student\n";
+        loadFromCSV(argc >= 3 ? argv[2] : "library_data.csv");
+        saveBinarySnapshot(argc >= 4 ? argv[3] : "library_data.snap");
+        return 0;
     }
-    for (const auto &facultyPair : library.faculties)
+    if (argc >= 2 && string(argv[1]) == "--snapshot-to-csv")
     {
-        Faculty *faculty = facultyPair.second;
-        file << faculty->UniqueId << ","
-             << faculty->name << ","
-             << faculty->getPassword() << "," // Use getPassword()
-             << "faculty\n";
+        if (!loadBinarySnapshot(argc >= 3 ? argv[2] : "library_data.snap"))
+            return 1;
+        saveToCSV(argc >= 4 ? argv[3] : "library_data.csv");
+        return 0;
     }
-    for (const auto &librarianPair : library.librarians)
+
+    if (argc >= 2 && string(argv[1]) == "--bench-catalog")
     {
-        Librarian *librarian = librarianPair.second;
-        file << librarian->UniqueId << ","
-             << librarian->name << ","
-             << librarian->getPassword() << "," // Use getPassword()
-             << "librarian\n";
+        vector<size_t> sizes;
+        for (int i = 2; i < argc; i++)
+            sizes.push_back(max(1L, atol(argv[i])));
+        if (sizes.empty())
+            sizes = {10000, 1000000, 10000000};
+        runCatalogBenchmark(sizes);
+        return 0;
     }
 
-    // Save current bookings
-    file << "\nCurrentBookings\n";
-    file << "BookingID,UserID,BookID,BookingDate,BorrowDate,ReturnDate,Fine,Type\n";
-    for (const auto &studentPair : library.students)
+    if (argc >= 2 && string(argv[1]) == "--bench-logins")
     {
-        Student *student = studentPair.second;
-        for (const auto &bookingPair : student->account.current)
+        size_t users = 1000, logins = 1000;
+        unsigned iterations = passwordIterations;
+        for (int i = 2; i + 1 < argc; i += 2)
         {
-            Booking *booking = bookingPair.second;
-            file << booking->bookingId << ","
-                 << student->UniqueId << ","
-                 << booking->bookId << ","
-                 << booking->bookingDate << ","
-                 << booking->borrowDate << ","
-                 << booking->returnDate << ","
-                 << booking->fine << ","
-                 << (booking->type == BookingType::RESERVED ? "Reserved" : "DirectBorrow") << "\n";
+            string arg = argv[i];
+            if (arg == "--users")
+                users = max(1L, atol(argv[i + 1]));
+            else if (arg == "--logins")
+                logins = max(1L, atol(argv[i + 1]));
+            else if (arg == "--iterations")
+                iterations = max(1L, atol(argv[i + 1]));
         }
+        runLoginBenchmark(users, logins, iterations);
+        return 0;
     }
-    for (const auto &facultyPair : library.faculties)
+
+    // Benchmark suite: --bench [--books N] [--users N] [--history N] [--ops N] [--zipf S]
+    // [--rounds N] [--seed N] [--json results.json]
+    if (argc >= 2 && string(argv[1]) == "--bench")
     {
-        Faculty *faculty = facultyPair.second;
-        for (const auto &bookingPair : faculty->account.current)
+        BenchConfig config;
+        for (int i = 2; i + 1 < argc; i += 2)
         {
-            Booking *booking = bookingPair.second;
-            file << booking->bookingId << ","
-                 << faculty->UniqueId << ","
-                 << booking->bookId << ","
-                 << booking->bookingDate << ","
-                 << booking->borrowDate << ","
-                 << booking->returnDate << ","
-                 << booking->fine << ","
-                 << (booking->type == BookingType::RESERVED ? "Reserved" : "DirectBorrow") << "\n";
+            string arg = argv[i];
+            const char *value = argv[i + 1];
+            if (arg == "--books")
+                config.books = max(1L, atol(value));
+            else if (arg == "--users")
+                config.users = max(1L, atol(value));
+            else if (arg == "--history")
+                config.history = max(0L, atol(value));
+            else if (arg == "--ops")
+                config.ops = max(0L, atol(value));
+            else if (arg == "--zipf")
+                config.zipf = max(0.0, atof(value));
+            else if (arg == "--rounds")
+                config.rounds = max(0L, atol(value));
+            else if (arg == "--seed")
+                config.seed = strtoull(value, nullptr, 10);
+            else if (arg == "--json")
+                config.jsonPath = value;
         }
+        return runBenchmark(config);
     }
 
-    // Save history bookings
-    file << "\nHistoryBookings\n";
-    file << "BookingID,UserID,BookID,BookingDate,BorrowDate,ReturnDate,Fine,Type\n";
-    for (const auto &studentPair : library.students)
+    // Listing options: --page-size N and --table; journal durability: --durability <level>
+    for (int i = 1; i < argc; i++)
     {
-        Student *student = studentPair.second;
-        for (const auto &bookingPair : student->account.history)
+        string arg = argv[i];
+        if (arg == "--page-size" && i + 1 < argc)
+            reportOptions.pageSize = max(1, atoi(argv[++i]));
+        else if (arg == "--table")
+            reportOptions.table = true;
+        else if (arg == "--durability" && i + 1 < argc && !parseDurability(argv[++i]))
         {
-            Booking *booking = bookingPair.second;
-            file << booking->bookingId << ","
-                 << student->UniqueId << ","
-                 << booking->bookId << ","
-                 << booking->bookingDate << ","
-                 << booking->borrowDate << ","
-                 << booking->returnDate << ","
-                 << booking->fine << ","
-                 << (booking->type == BookingType::RESERVED ? "Reserved" : "DirectBorrow") << "\n";
+            cerr << "Invalid durability level. Use none, commit, group or group:<ms>.\n";
+            return 2;
         }
     }
-    for (const auto &facultyPair : library.faculties)
+
+    // Load the last snapshot and the changes made since
+    loadSnapshot();
+    replayJournal();
+
+    // Bulk import: --import-books <file> or --import-users <file>, then a fresh snapshot
+    for (int i = 1; i + 1 < argc; i++)
     {
-        Faculty *faculty = facultyPair.second;
-        for (const auto &bookingPair : faculty->account.history)
+        string arg = argv[i];
+        if (arg == "--import-books" || arg == "--import-users")
         {
-            Booking *booking = bookingPair.second;
-            file << booking->bookingId << ","
-                 << faculty->UniqueId << ","
-                 << booking->bookId << ","
-                 << booking->bookingDate << ","
-                 << booking->borrowDate << ","
-                 << booking->returnDate << ","
-                 << booking->fine << ","
-                 << (booking->type == BookingType::RESERVED ? "Reserved" : "DirectBorrow") << "\n";
+            if (!importFile(arg == "--import-books" ? ImportKind::BOOKS : ImportKind::USERS, argv[i + 1]))
+                return 1;
+            compactJournal();
+            journal.close();
+            return 0;
         }
     }
 
-    file.close();
-    cout << "Library data saved to library_data.csv\n";
-}
-
-void loadFromCSV()
-{
-    ifstream file("library_data.csv");
-    if (!file.is_open())
+    // Password migration: --hash-passwords hashes any plaintext passwords, then a fresh snapshot
+    for (int i = 1; i < argc; i++)
     {
-        cerr << "Error: Could not open library_data.csv\n";
-        return;
+        if (string(argv[i]) == "--hash-passwords")
+        {
+            hashLegacyPasswords();
+            compactJournal();
+            journal.close();
+            return 0;
+        }
     }
 
-    string line;
-    string section = "";
-
-    while (getline(file, line))
+    // Overdue run: --overdue <ddmmyyyy> [--notices <file>] prints notices instead of the menus
+    for (int i = 1; i + 1 < argc; i++)
     {
-        if (line.empty())
-            continue;
-
-        // Check for section headers
-        if (line == "Books")
-        {
-            section = "Books";
-            getline(file, line); // Skip header
-            continue;
-        }
-        else if (line == "Users")
+        if (string(argv[i]) == "--overdue")
         {
-            section = "Users";
-            getline(file, line); // Skip header
-            continue;
-        }
-        else if (line == "CurrentBookings")
-        {
-            section = "CurrentBookings";
-            getline(file, line); // Skip header
-            continue;
+            string noticesPath;
+            for (int j = 1; j + 1 < argc; j++)
+                if (string(argv[j]) == "--notices")
+                    noticesPath = argv[j + 1];
+            int status = runOverdue(argv[i + 1], noticesPath);
+            journal.close();
+            return status;
         }
-        else if (line == "HistoryBookings")
+    }
+
+    // History analytics: --history-report <books|users|roles|months|years> [--from ddmmyyyy]
+    // [--to ddmmyyyy] [--by borrow|return] [--role student|faculty] [--limit N]
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (string(argv[i]) == "--history-report")
         {
-            section = "HistoryBookings";
-            getline(file, line); // Skip header
-            continue;
+            int status = runHistoryReport(vector<string>(argv + i + 1, argv + argc));
+            journal.close();
+            return status;
         }
+    }
 
-        // Process data based on the current section
-        if (section == "Books")
+    // Server mode: --serve <socket> [--threads N] serves sessions instead of the menus
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (string(argv[i]) == "--serve")
         {
-            stringstream ss(line);
-            string bookId, title, author, publisher, ISBN, yearStr, status, reservationQueue;
-            getline(ss, bookId, ',');
-            getline(ss, title, ',');
-            getline(ss, author, ',');
-            getline(ss, publisher, ',');
-            getline(ss, ISBN, ',');
-            getline(ss, yearStr, ',');
-            getline(ss, status, ',');
-            getline(ss, reservationQueue); // Read the rest of the line as reservationQueue
-
-            // Validate year (ensure it's a valid integer)
-            int year = 0;
-            try
-            {
-                year = stoi(yearStr);
-            }
-            catch (const invalid_argument &e)
-            {
-                cerr << "Invalid year for book " << bookId << ": " << yearStr << "\n";
-                continue; // Skip this book
-            }
-            catch (const out_of_range &e)
-            {
-                cerr << "Year out of range for book " << bookId << ": " << yearStr << "\n";
-                continue; // Skip this book
-            }
-
-            // Create the book
-            Book *book = new Book(bookId, title, author, publisher, ISBN, year);
-            book->status = (status == "Available") ? BookStatus::AVAILABLE : BookStatus::BORROWED;
-
-            // Parse reservation queue (handle empty or invalid queues)
-            if (!reservationQueue.empty())
-            {
-                stringstream queueStream(reservationQueue);
-                string userId;
-                while (getline(queueStream, userId, ';'))
-                {
-                    if (!userId.empty())
-                    {
-                        book->reservationQueue.push_back(userId);
-                    }
-                }
-            }
-
-            library.books[bookId] = book;
+            size_t workerCount = max(4u, thread::hardware_concurrency());
+            for (int j = 1; j + 1 < argc; j++)
+                if (string(argv[j]) == "--threads")
+                    workerCount = max(1, atoi(argv[j + 1]));
+            int status = runServer(argv[i + 1], workerCount);
+            journal.close();
+            return status;
         }
-        else if (section == "Users")
-        {
-            stringstream ss(line);
-            string userId, name, password, userType;
-            getline(ss, userId, ',');
-            getline(ss, name, ',');
-            getline(ss, password, ',');
-            getline(ss, userType, ',');
+    }
 
-            if (userType == "student")
-            {
-                Student *student = new Student(name, userId, "");
-                student->setPassword(password); // Use setPassword()
-                library.students[userId] = student;
-                library.userTypes[userId] = "student";
-            }
-            else if (userType == "faculty")
-            {
-                Faculty *faculty = new Faculty(name, userId, "");
-                faculty->setPassword(password); // Use setPassword()
-                library.faculties[userId] = faculty;
-                library.userTypes[userId] = "faculty";
-            }
-            else if (userType == "librarian")
-            {
-                Librarian *librarian = new Librarian(name, userId, "");
-                librarian->setPassword(password); // Use setPassword()
-                library.librarians[userId] = librarian;
-                library.userTypes[userId] = "librarian";
-            }
+    // Drop-box mode: --drop-box <file> returns the books listed in the file in one pass
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (string(argv[i]) == "--drop-box")
+        {
+            int status = runDropBox(argv[i + 1]);
+            journal.close();
+            return status;
         }
-        else if (section == "CurrentBookings" || section == "HistoryBookings")
-        {
-            stringstream ss(line);
-            string bookingId, userId, bookId, bookingDate, borrowDate, returnDate, fineStr, typeStr;
-            getline(ss, bookingId, ',');
-            getline(ss, userId, ',');
-            getline(ss, bookId, ',');
-            getline(ss, bookingDate, ',');
-            getline(ss, borrowDate, ',');
-            getline(ss, returnDate, ',');
-            getline(ss, fineStr, ',');
-            getline(ss, typeStr, ',');
-
-            // Validate fine (ensure it's a valid integer)
-            int fine = 0;
-            try
-            {
-                fine = stoi(fineStr);
-            }
-            catch (const invalid_argument &e)
-            {
-                cerr << "Invalid fine for booking " << bookingId << ": " << fineStr << "\n";
-                continue; // Skip this booking
-            }
-            catch (const out_of_range &e)
-            {
-                cerr << "Fine out of range for booking " << bookingId << ": " << fineStr << "\n";
-                continue; // Skip this booking
-            }
-
-            // Determine booking type
-            BookingType type = (typeStr == "Reserved") ? BookingType::RESERVED : BookingType::DIRECT_BORROW;
-
-            // Create the booking
-            Booking *booking = new Booking(
-                bookingId, bookingDate, borrowDate, returnDate, fine, type, bookId,
-                library.books[bookId]->title, library.books[bookId]->author,
-                library.books[bookId]->publisher, library.books[bookId]->ISBN, library.books[bookId]->year);
+    }
 
-            // Add booking to the appropriate user's account
-            if (section == "CurrentBookings")
-            {
-                if (library.userTypes[userId] == "student")
-                {
-                    library.students[userId]->account.current[bookingId] = booking;
-                }
-                else if (library.userTypes[userId] == "faculty")
-                {
-                    library.faculties[userId]->account.current[bookingId] = booking;
-                }
-            }
-            else if (section == "HistoryBookings")
-            {
-                if (library.userTypes[userId] == "student")
-                {
-                    library.students[userId]->account.history[bookingId] = booking;
-                }
-                else if (library.userTypes[userId] == "faculty")
-                {
-                    library.faculties[userId]->account.history[bookingId] = booking;
-                }
-            }
+    // Batch mode: --batch <script> runs the script instead of the menus
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (string(argv[i]) == "--batch")
+        {
+            int status = runBatch(argv[i + 1]);
+            journal.close();
+            return status;
         }
     }
 
-    file.close();
-    cout << "Library data loaded from library_data.csv\n";
-}
-// Main function
-int main()
-{
-    // Load data from CSV
-    loadFromCSV();
-
     // Main program logic
     bool f = true;
     while (f)
@@ -1667,8 +6721,8 @@ int main()
             f = false;
     }
 
-    // Save data to CSV before exiting
-    saveToCSV();
+    // Every change is already in the journal; it is folded into the CSV on compaction
+    journal.close();
     cout << "System Closed" << endl;
 
     return 0;